@@ -0,0 +1,144 @@
+#ifndef CBBOC_BATCHKERNELS_HPP
+#define CBBOC_BATCHKERNELS_HPP
+
+#include "PackedBitvector.hpp"
+#include "ValueKernels.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+// Vectorised kernels are compiled with per-function target attributes
+// and chosen at runtime, so no -m flags are needed to build them.
+// Define CBBOC_DISABLE_X86_KERNELS to build the scalar paths only.
+
+#if !defined( CBBOC_DISABLE_X86_KERNELS ) && ( defined( __GNUC__ ) || defined( __clang__ ) ) \
+	&& ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define CBBOC_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define CBBOC_HAVE_X86_KERNELS 0
+#endif
+
+//////////////////////////////////////////////////////////////////////
+
+namespace cbboc_kernels {
+
+///////////////////////////////////
+
+inline bool cpuHasAvx2() {
+#if CBBOC_HAVE_X86_KERNELS
+	static const bool result = __builtin_cpu_supports( "avx2" ) != 0;
+	return result;
+#else
+	return false;
+#endif
+}
+
+inline bool cpuHasBmi2() {
+#if CBBOC_HAVE_X86_KERNELS
+	static const bool result = __builtin_cpu_supports( "bmi2" ) != 0;
+	return result;
+#else
+	return false;
+#endif
+}
+
+///////////////////////////////////
+
+#if CBBOC_HAVE_X86_KERNELS
+
+/**
+ * Evaluates packed candidates eight at a time against a flattened
+ * instance (see ProblemInstance): the candidates' words are interleaved
+ * so that one load fetches a word of four candidates, the four table
+ * indices are built in a vector register, and the table entries are
+ * fetched with a single gather (two, codes then palette values, when
+ * the pool is coded). Each lane sums its subfunctions in the same
+ * order as the scalar path, so results are bit-identical to it. Only
+ * for DOUBLE_POOL and CODED_POOL storage.
+ *
+ * Only whole blocks of eight are evaluated; returns how many candidates
+ * (a multiple of eight) were written to result.
+ */
+
+__attribute__(( target( "avx2" ) ))
+inline size_t valuesAvx2( const InstanceView& instance, const PackedBitvector* batch, size_t count, double* result ) {
+
+	const size_t BLOCK_SIZE = 8;
+	if( count < BLOCK_SIZE )
+		return 0;
+
+	const int M = instance.M;
+	const int K = instance.K;
+	const bool coded = instance.storage == CODED_POOL;
+	const size_t numWords = batch[ 0 ].numWords();
+	std::vector< uint64_t > interleaved( numWords * BLOCK_SIZE );
+	const __m256i one = _mm256_set1_epi64x( 1 );
+	const __m128i codeMask = _mm_set1_epi32( 0xFF );
+	const __m128i allLanes = _mm_set1_epi32( -1 );
+	const __m256d allLanesPd = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+
+	size_t first = 0;
+	for( ; first + BLOCK_SIZE <= count; first += BLOCK_SIZE ) {
+
+		for( size_t c=0; c<BLOCK_SIZE; ++c ) {
+			const uint64_t* words = batch[ first + c ].data();
+			for( size_t w=0; w<numWords; ++w )
+				interleaved[ w * BLOCK_SIZE + c ] = words[ w ];
+		}
+
+		__m256d total0 = _mm256_setzero_pd();
+		__m256d total1 = _mm256_setzero_pd();
+		const int* vars = instance.vars;
+		for( int i=0; i<M; ++i, vars += K ) {
+
+			__m256i index0 = _mm256_setzero_si256();
+			__m256i index1 = _mm256_setzero_si256();
+			for( int j=0; j<K; ++j ) {
+				const uint64_t* w = interleaved.data() + ( vars[ j ] >> 6 ) * BLOCK_SIZE;
+				const __m128i shift = _mm_cvtsi32_si128( vars[ j ] & 63 );
+
+				const __m256i words0 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( w ) );
+				const __m256i words1 = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( w + 4 ) );
+				index0 = _mm256_or_si256( _mm256_slli_epi64( index0, 1 ),
+					_mm256_and_si256( _mm256_srl_epi64( words0, shift ), one ) );
+				index1 = _mm256_or_si256( _mm256_slli_epi64( index1, 1 ),
+					_mm256_and_si256( _mm256_srl_epi64( words1, shift ), one ) );
+			}
+
+			if( coded ) {
+				// 32-bit gathers at byte offsets; the pool's padding keeps them in bounds.
+				const int* codes = reinterpret_cast< const int* >( instance.codes + instance.offsets[ i ] );
+				const __m128i codes0 = _mm_and_si128( _mm256_mask_i64gather_epi32( codeMask, codes, index0, allLanes, 1 ), codeMask );
+				const __m128i codes1 = _mm_and_si128( _mm256_mask_i64gather_epi32( codeMask, codes, index1, allLanes, 1 ), codeMask );
+				total0 = _mm256_add_pd( total0, _mm256_mask_i32gather_pd( total0, instance.palette, codes0, allLanesPd, 8 ) );
+				total1 = _mm256_add_pd( total1, _mm256_mask_i32gather_pd( total1, instance.palette, codes1, allLanesPd, 8 ) );
+			}
+			else {
+				const double* table = instance.pool + instance.offsets[ i ];
+				total0 = _mm256_add_pd( total0, _mm256_i64gather_pd( table, index0, 8 ) );
+				total1 = _mm256_add_pd( total1, _mm256_i64gather_pd( table, index1, 8 ) );
+			}
+		}
+
+		_mm256_storeu_pd( result + first, total0 );
+		_mm256_storeu_pd( result + first + 4, total1 );
+	}
+
+	return first;
+}
+
+#endif
+
+///////////////////////////////////
+
+} // namespace cbboc_kernels {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,314 @@
+#ifndef CBBOC_BINARYINSTANCE_HPP
+#define CBBOC_BINARYINSTANCE_HPP
+
+#include "MappedFile.hpp"
+#include "SharedArray.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Binary instance files: a ProblemInstance in its compiled layout, to be
+ * mapped into memory and evaluated in place ( see MappedFile ), with no
+ * parsing and no copying.
+ *
+ * A file is a 128-byte Header followed by four arrays, each starting at
+ * a multiple of ALIGNMENT bytes and padded with zeros to the next one:
+ * the variable indices ( int32, K per subfunction ), the pool offset of
+ * each subfunction's table ( int32, see InternedTables ), the palette
+ * ( double ), and the pool, either as doubles or, if coded, as one-byte
+ * codes with their padding. Numbers are in the byte order of the machine
+ * that wrote the file; a file from a machine of the other byte order, or
+ * of another VERSION, is rejected. The checksum is a 64-bit FNV-1a hash
+ * of all the bytes after the header, taken eight at a time.
+ *
+ * The header also records the size and modification time, to the
+ * nanosecond, of the text file the instance was converted from, so that
+ * a stale conversion can be recognized without reading either file.
+ */
+
+namespace cbboc_binary {
+
+///////////////////////////////////
+
+const char MAGIC[ 8 ] = { 'C', 'B', 'B', 'O', 'C', 'B', 'I', 'N' };
+const uint32_t VERSION = 3; // ^ 2: upperBound tightened by mini-bucket elimination; 3: sourceModified in nanoseconds.
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const size_t ALIGNMENT = 64;
+
+struct Header {
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t fileSize;
+	uint64_t checksum;
+
+	uint64_t numGenes;
+	int32_t maxEvalsPerInstance;
+	int32_t K;
+	int32_t M;
+	int32_t coded;
+	uint64_t numEntries; // ^ pool entries, or codes including their padding.
+	uint64_t paletteSize;
+	double upperBound;
+
+	uint64_t sourceSize;
+	int64_t sourceModified; // ^ nanoseconds since the epoch.
+
+	// Byte offsets of the arrays from the start of the file.
+	uint64_t varsOffset;
+	uint64_t tableOffsetsOffset;
+	uint64_t paletteOffset;
+	uint64_t entriesOffset;
+};
+
+static_assert( sizeof( Header ) == 128, "unexpected padding in cbboc_binary::Header" );
+
+// What writeInstance() needs of an instance in STANDARD storage; the
+// table fields are those of its InternedTables, one of pool and codes
+// being null.
+struct Layout {
+	size_t numGenes;
+	int maxEvalsPerInstance;
+	int K;
+	int M;
+	const int* vars;
+	const int* tableOffsets;
+	const double* palette;
+	size_t paletteSize;
+	const double* pool;
+	const unsigned char* codes;
+	size_t numEntries;
+	double upperBound;
+};
+
+// The arrays of a mapped file, each keeping the mapping alive.
+struct MappedInstance {
+	Header header;
+	SharedArray< int > vars;
+	SharedArray< int > tableOffsets;
+	SharedArray< double > palette;
+	SharedArray< double > pool;
+	SharedArray< unsigned char > codes;
+};
+
+///////////////////////////////////
+
+namespace detail {
+
+inline uint64_t aligned( uint64_t bytes ) { return ( bytes + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT; }
+
+inline void fail( const std::string& path, const std::string& message ) {
+	throw std::runtime_error( "bad binary instance " + path + ": " + message );
+}
+
+} // namespace detail {
+
+///////////////////////////////////
+
+// FNV-1a over the 64-bit words of [ begin, begin + size ), size being a
+// multiple of 8.
+inline uint64_t checksumOf( const char* begin, size_t size ) {
+	uint64_t h = 14695981039346656037ULL;
+	for( size_t b=0; b + 8 <= size; b += 8 ) {
+		uint64_t word;
+		std::memcpy( &word, begin + b, sizeof( word ) );
+		h = ( h ^ word ) * 1099511628211ULL;
+	}
+	return h;
+}
+
+// The size and modification time, in nanoseconds since the epoch, of
+// the file at path; false if there is none. Whole seconds would miss
+// an edit that keeps the size within the second of the conversion.
+inline bool fileInfo( const std::string& path, uint64_t& size, int64_t& modified ) {
+	struct stat info;
+	if( stat( path.c_str(), &info ) != 0 )
+		return false;
+
+#ifdef __APPLE__
+	const struct timespec& mtime = info.st_mtimespec;
+#else
+	const struct timespec& mtime = info.st_mtim;
+#endif
+	size = static_cast< uint64_t >( info.st_size );
+	modified = static_cast< int64_t >( mtime.tv_sec ) * 1000000000 + mtime.tv_nsec;
+	return true;
+}
+
+// Where the binary form of the text instance file at path goes: the
+// same name with .bin in place of .txt.
+inline std::string binaryPathFor( const std::string& path ) {
+	const std::string txt = ".txt";
+	if( path.size() >= txt.size() && path.compare( path.size() - txt.size(), txt.size(), txt ) == 0 )
+		return path.substr( 0, path.size() - txt.size() ) + ".bin";
+	return path + ".bin";
+}
+
+// Reads just the header; false if path is not a binary instance file
+// of this VERSION and byte order.
+inline bool readHeader( const std::string& path, Header& header ) {
+	std::ifstream ifs( path.c_str(), std::ios::binary );
+	if( !ifs.read( reinterpret_cast< char* >( &header ), sizeof( header ) ) )
+		return false;
+
+	return std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) == 0 && header.version == VERSION &&
+		header.byteOrder == BYTE_ORDER_MARK;
+}
+
+inline bool isBinaryInstance( const std::string& path ) {
+	std::ifstream ifs( path.c_str(), std::ios::binary );
+	char magic[ sizeof( MAGIC ) ];
+	return ifs.read( magic, sizeof( magic ) ) && std::memcmp( magic, MAGIC, sizeof( MAGIC ) ) == 0;
+}
+
+// Whether binaryPath was converted from textPath as it is now.
+inline bool isUpToDate( const std::string& binaryPath, const std::string& textPath ) {
+	Header header;
+	uint64_t size = 0;
+	int64_t modified = 0;
+	return readHeader( binaryPath, header ) && fileInfo( textPath, size, modified ) &&
+		header.sourceSize == size && header.sourceModified == modified;
+}
+
+///////////////////////////////////
+
+inline void writeInstance( const Layout& layout, uint64_t sourceSize, int64_t sourceModified, std::ostream& os ) {
+	using detail::aligned;
+	const size_t numVars = static_cast< size_t >( layout.M ) * layout.K;
+	const bool coded = layout.codes != nullptr;
+
+	Header header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.numGenes = layout.numGenes;
+	header.maxEvalsPerInstance = layout.maxEvalsPerInstance;
+	header.K = layout.K;
+	header.M = layout.M;
+	header.coded = coded ? 1 : 0;
+	header.numEntries = layout.numEntries;
+	header.paletteSize = layout.paletteSize;
+	header.upperBound = layout.upperBound;
+	header.sourceSize = sourceSize;
+	header.sourceModified = sourceModified;
+
+	header.varsOffset = aligned( sizeof( Header ) );
+	header.tableOffsetsOffset = header.varsOffset + aligned( numVars * sizeof( int32_t ) );
+	header.paletteOffset = header.tableOffsetsOffset + aligned( static_cast< size_t >( layout.M ) * sizeof( int32_t ) );
+	header.entriesOffset = header.paletteOffset + aligned( layout.paletteSize * sizeof( double ) );
+	header.fileSize = header.entriesOffset + aligned( layout.numEntries * ( coded ? 1 : sizeof( double ) ) );
+
+	std::vector< char > file( header.fileSize, 0 );
+	if( numVars > 0 )
+		std::memcpy( &file[ header.varsOffset ], layout.vars, numVars * sizeof( int32_t ) );
+	if( layout.M > 0 )
+		std::memcpy( &file[ header.tableOffsetsOffset ], layout.tableOffsets, layout.M * sizeof( int32_t ) );
+	if( layout.paletteSize > 0 )
+		std::memcpy( &file[ header.paletteOffset ], layout.palette, layout.paletteSize * sizeof( double ) );
+	if( layout.numEntries > 0 )
+		std::memcpy( &file[ header.entriesOffset ], coded ? static_cast< const void* >( layout.codes ) : layout.pool,
+			layout.numEntries * ( coded ? 1 : sizeof( double ) ) );
+
+	header.checksum = checksumOf( file.data() + sizeof( Header ), file.size() - sizeof( Header ) );
+	std::memcpy( file.data(), &header, sizeof( header ) );
+	os.write( file.data(), static_cast< std::streamsize >( file.size() ) );
+	if( !os )
+		throw std::runtime_error( "error writing binary instance" );
+}
+
+///////////////////////////////////
+
+// The binary instance image of size bytes at base, which owner keeps
+// alive, path naming it in errors; base must be aligned for doubles. The
+// layout is always checked, the variable indices included, so that
+// evaluation stays in bounds; the checksum only if verifyChecksum, since
+// it reads the whole image.
+inline MappedInstance mapInstance( const char* base, size_t size, const std::shared_ptr< const void >& owner,
+	const std::string& path, bool verifyChecksum = false ) {
+	using detail::aligned;
+	using detail::fail;
+	if( size < sizeof( Header ) )
+		fail( path, "too short" );
+	if( reinterpret_cast< uintptr_t >( base ) % alignof( double ) != 0 )
+		fail( path, "misaligned" );
+
+	MappedInstance result;
+	Header& header = result.header;
+	std::memcpy( &header, base, sizeof( header ) );
+	if( std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) != 0 )
+		fail( path, "not a binary instance file" );
+	if( header.version != VERSION || header.byteOrder != BYTE_ORDER_MARK )
+		fail( path, "unsupported version or byte order" );
+	if( header.fileSize != size )
+		fail( path, "truncated" );
+	if( header.K <= 0 || header.K >= 31 || header.M < 0 || header.maxEvalsPerInstance < 0 ||
+		header.numGenes == 0 || header.numGenes > 0x7FFFFFFF )
+		fail( path, "bad header" );
+
+	const uint64_t numVars = static_cast< uint64_t >( header.M ) * header.K;
+	const uint64_t entryBytes = header.numEntries * ( header.coded ? 1 : sizeof( double ) );
+	if( header.paletteSize > size || header.numEntries > size ||
+		header.varsOffset != aligned( sizeof( Header ) ) ||
+		header.tableOffsetsOffset != header.varsOffset + aligned( numVars * sizeof( int32_t ) ) ||
+		header.paletteOffset != header.tableOffsetsOffset + aligned( static_cast< uint64_t >( header.M ) * sizeof( int32_t ) ) ||
+		header.entriesOffset != header.paletteOffset + aligned( header.paletteSize * sizeof( double ) ) ||
+		header.fileSize != header.entriesOffset + aligned( entryBytes ) )
+		fail( path, "inconsistent array sizes" );
+	if( header.coded && header.paletteSize == 0 && header.numEntries > 0 )
+		fail( path, "codes without a palette" );
+
+	if( verifyChecksum && checksumOf( base + sizeof( Header ), size - sizeof( Header ) ) != header.checksum )
+		fail( path, "checksum mismatch" );
+
+	result.vars = SharedArray< int >( reinterpret_cast< const int* >( base + header.varsOffset ), numVars, owner );
+	for( size_t e=0; e<result.vars.size(); ++e )
+		if( result.vars[ e ] < 0 || static_cast< uint64_t >( result.vars[ e ] ) >= header.numGenes )
+			fail( path, "variable index out of range" );
+
+	result.tableOffsets = SharedArray< int >( reinterpret_cast< const int* >( base + header.tableOffsetsOffset ), header.M, owner );
+	const uint64_t tableSize = uint64_t( 1 ) << header.K;
+	for( size_t i=0; i<result.tableOffsets.size(); ++i )
+		if( result.tableOffsets[ i ] < 0 || result.tableOffsets[ i ] % tableSize != 0 ||
+			result.tableOffsets[ i ] + tableSize > header.numEntries )
+			fail( path, "table offset out of range" );
+
+	result.palette = SharedArray< double >( reinterpret_cast< const double* >( base + header.paletteOffset ), header.paletteSize, owner );
+	if( header.coded ) {
+		result.codes = SharedArray< unsigned char >( reinterpret_cast< const unsigned char* >( base + header.entriesOffset ), header.numEntries, owner );
+		for( size_t e=0; e<result.codes.size(); ++e )
+			if( result.codes[ e ] >= header.paletteSize )
+				fail( path, "code out of range" );
+	}
+	else
+		result.pool = SharedArray< double >( reinterpret_cast< const double* >( base + header.entriesOffset ), header.numEntries, owner );
+	return result;
+}
+
+// Maps the binary instance file at path, as above.
+inline MappedInstance mapInstance( const std::string& path, bool verifyChecksum = false ) {
+	const std::shared_ptr< const MappedFile > file = std::make_shared< const MappedFile >( path );
+	return mapInstance( file->data(), file->size(), file, path, verifyChecksum );
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_binary {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
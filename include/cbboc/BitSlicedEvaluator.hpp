@@ -0,0 +1,254 @@
+#ifndef CBBOC_BITSLICEDEVALUATOR_HPP
+#define CBBOC_BITSLICEDEVALUATOR_HPP
+
+#include "PackedBitvector.hpp"
+#include "ProblemInstance.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+// In-place transpose of a 64x64 bit matrix: afterwards, bit c of a[ r ]
+// holds what was bit r of a[ c ].
+inline void transpose64( uint64_t a[ 64 ] ) {
+	uint64_t m = 0x00000000FFFFFFFFULL;
+	for( int j=32; j!=0; j >>= 1, m ^= m << j ) {
+		for( int k=0; k<64; k = ( ( k | j ) + 1 ) & ~j ) {
+			const uint64_t t = ( ( a[ k ] >> j ) ^ a[ k | j ] ) & m;
+			a[ k ] ^= t << j;
+			a[ k | j ] ^= t;
+		}
+	}
+}
+
+/**
+ * Transposes up to 64 packed candidates into bit-sliced form: bit c of
+ * slices[ v ] is variable v of candidate c. Lanes at or beyond count
+ * are zero. slices must have room for batch[ 0 ].size() words.
+ */
+inline void transposeToBitSlices( const PackedBitvector* batch, size_t count, uint64_t* slices ) {
+	if( count > 64 )
+		throw std::invalid_argument( "Bad count in transposeToBitSlices" );
+	if( count == 0 )
+		return;
+
+	const size_t numBits = batch[ 0 ].size();
+	uint64_t block[ 64 ];
+	for( size_t w=0; w<batch[ 0 ].numWords(); ++w ) {
+		for( size_t c=0; c<64; ++c )
+			block[ c ] = c < count ? batch[ c ].word( w ) : 0;
+
+		transpose64( block );
+		const size_t numVars = std::min< size_t >( 64, numBits - w * 64 );
+		std::copy( block, block + numVars, slices + w * 64 );
+	}
+}
+
+/**
+ * Inverse of transposeToBitSlices: writes lanes 0 .. count of slices
+ * back out as count packed candidates of numBits bits each.
+ */
+inline void transposeFromBitSlices( const uint64_t* slices, size_t numBits, size_t count, PackedBitvector* batch ) {
+	if( count > 64 )
+		throw std::invalid_argument( "Bad count in transposeFromBitSlices" );
+
+	for( size_t c=0; c<count; ++c )
+		batch[ c ] = PackedBitvector( numBits );
+
+	uint64_t block[ 64 ];
+	for( size_t w=0; w<( numBits + 63 ) / 64; ++w ) {
+		const size_t numVars = std::min< size_t >( 64, numBits - w * 64 );
+		std::fill( std::copy( slices + w * 64, slices + w * 64 + numVars, block ), block + 64, 0 );
+		transpose64( block );
+		for( size_t c=0; c<count; ++c )
+			for( size_t i=0; i<numVars; ++i )
+				if( ( block[ c ] >> i ) & 1 )
+					batch[ c ].set( w * 64 + i, true );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Evaluates 64 candidates per pass over a ProblemInstance, from a
+ * bit-sliced population (see transposeToBitSlices). For each subfunction
+ * the 2^K minterm masks over its variables' slices say which candidates
+ * select each table entry, so building the table indices costs about
+ * 2^(K+1) word-wide ANDs for all 64 candidates together.
+ *
+ * When the instance's tables use at most MAX_PALETTE_SIZE distinct
+ * values (as in sample1 and sample3), the minterms are folded into one
+ * mask per distinct value and counted with bit-sliced counters, so no
+ * per-candidate work is done until the end of the pass. The result is
+ * then a sum of count * value over the palette, which agrees with
+ * ProblemInstance::value to within rounding. Otherwise each candidate
+ * adds its table entries in subfunction order, as doubles, and the
+ * results are identical to ProblemInstance::value in STANDARD storage;
+ * in COMPACT storage, whose totals are summed in fixed point, they
+ * agree to within rounding only.
+ *
+ * The instance must outlive the evaluator.
+ */
+
+class BitSlicedEvaluator {
+
+	const ProblemInstance& instance;
+	const std::vector< int > varIndices;
+
+	// Distinct table values, and the palette index of each table entry;
+	// both empty when the palette is too large for counting mode.
+	std::vector< double > palette;
+	std::vector< unsigned char > entryCodes;
+	int counterBits;
+
+	///////////////////////////////
+
+	void buildPalette() {
+		const std::vector< double > tables = instance.getFnTables();
+		std::vector< double > distinct( tables );
+		std::sort( distinct.begin(), distinct.end() );
+		distinct.erase( std::unique( distinct.begin(), distinct.end() ), distinct.end() );
+		if( distinct.size() > MAX_PALETTE_SIZE )
+			return;
+
+		palette = distinct;
+		entryCodes.resize( tables.size() );
+		for( size_t e=0; e<tables.size(); ++e )
+			entryCodes[ e ] = static_cast< unsigned char >(
+				std::lower_bound( palette.begin(), palette.end(), tables[ e ] ) - palette.begin() );
+
+		counterBits = 1;
+		while( ( 1L << counterBits ) <= instance.getM() )
+			++counterBits;
+	}
+
+	// Builds the 2^K minterms of subfunction vars, most significant 
+	// variable first, doubling the number of masks at each step to match
+	// ProblemInstance::value's table indexing.
+	static void minterms( const uint64_t* slices, const int* vars, int K, uint64_t laneMask, uint64_t* masks ) {
+		masks[ 0 ] = laneMask;
+		for( int j=0; j<K; ++j ) {
+			const uint64_t slice = slices[ vars[ j ] ];
+			for( size_t t=size_t( 1 ) << j; t-- > 0; ) {
+				masks[ 2 * t + 1 ] = masks[ t ] & slice;
+				masks[ 2 * t ] = masks[ t ] & ~slice;
+			}
+		}
+	}
+
+	void valuesByCounting( const uint64_t* slices, size_t count, uint64_t laneMask, double* result ) const {
+		const int K = instance.getK();
+		const int M = instance.getM();
+		const size_t tableSize = size_t( 1 ) << K;
+		const size_t numCodes = palette.size();
+
+		// Every lane selects exactly one entry per subfunction, so the 
+		// count for code 0 is implied by the others and is not kept.
+		std::vector< uint64_t > masks( tableSize );
+		std::vector< uint64_t > counters( numCodes * counterBits, 0 );
+		const int* vars = varIndices.data();
+		const unsigned char* codes = entryCodes.data();
+		for( int i=0; i<M; ++i, vars += K, codes += tableSize ) {
+			minterms( slices, vars, K, laneMask, masks.data() );
+
+			// Ripple-carry add of one bit per lane into each code's counter.
+			for( size_t p=1; p<numCodes; ++p ) {
+				uint64_t selected = 0;
+				for( size_t t=0; t<tableSize; ++t )
+					selected |= masks[ t ] & ( uint64_t( 0 ) - ( codes[ t ] == p ) );
+
+				uint64_t* counter = counters.data() + p * counterBits;
+				for( uint64_t carry = selected; carry != 0; ++counter ) {
+					const uint64_t next = *counter & carry;
+					*counter ^= carry;
+					carry = next;
+				}
+			}
+		}
+
+		for( size_t c=0; c<count; ++c ) {
+			double total = 0.0;
+			long remaining = M;
+			for( size_t p=numCodes; p-- > 1; ) {
+				long n = 0;
+				for( int b=0; b<counterBits; ++b )
+					n |= static_cast< long >( ( counters[ p * counterBits + b ] >> c ) & 1 ) << b;
+				total += n * palette[ p ];
+				remaining -= n;
+			}
+			result[ c ] = total + remaining * palette[ 0 ];
+		}
+	}
+
+	void valuesByScatter( const uint64_t* slices, size_t count, uint64_t laneMask, double* result ) const {
+		const int K = instance.getK();
+		const int M = instance.getM();
+		const size_t tableSize = size_t( 1 ) << K;
+
+		double totals[ LANES ] = { 0.0 };
+		std::vector< uint64_t > masks( tableSize );
+		const int* vars = varIndices.data();
+		for( int i=0; i<M; ++i, vars += K ) {
+			minterms( slices, vars, K, laneMask, masks.data() );
+			for( size_t t=0; t<tableSize; ++t ) {
+				const double entry = instance.fnTableEntry( i, t );
+				for( uint64_t m = masks[ t ]; m != 0; m &= m - 1 )
+					totals[ countTrailingZeros64( m ) ] += entry;
+			}
+		}
+
+		std::copy( totals, totals + count, result );
+	}
+
+public:
+
+	static const size_t LANES = 64;
+	static const size_t MAX_PALETTE_SIZE = 16;
+
+	explicit BitSlicedEvaluator( const ProblemInstance& instance_ )
+	: instance( instance_ ), varIndices( instance_.getVarIndices() ), counterBits( 0 ) {
+		buildPalette();
+	}
+
+	///////////////////////////////
+
+	// True if values are computed with bit-sliced counters over a palette.
+	bool isCounting() const { return !palette.empty(); }
+
+	// Evaluate the first count lanes of a bit-sliced population of
+	// getNumGenes() slices; result receives count values.
+	void values( const uint64_t* slices, size_t count, double* result ) const {
+		if( count > LANES )
+			throw std::invalid_argument( "Bad count in BitSlicedEvaluator.values" );
+
+		const uint64_t laneMask = count == LANES ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << count ) - 1;
+		if( isCounting() )
+			valuesByCounting( slices, count, laneMask, result );
+		else
+			valuesByScatter( slices, count, laneMask, result );
+	}
+
+	// Evaluate count packed candidates, transposing 64 at a time.
+	void values( const PackedBitvector* batch, size_t count, double* result ) const {
+		for( size_t c=0; c<count; ++c )
+			if( batch[ c ].size() != instance.getNumGenes() )
+				throw std::invalid_argument( "Bad argument to BitSlicedEvaluator.values" );
+
+		const size_t lanes = LANES;
+		std::vector< uint64_t > slices( instance.getNumGenes() );
+		for( size_t first=0; first<count; first += lanes ) {
+			const size_t n = std::min( lanes, count - first );
+			transposeToBitSlices( batch + first, n, slices.data() );
+			values( slices.data(), n, result + first );
+		}
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
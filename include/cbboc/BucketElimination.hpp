@@ -0,0 +1,131 @@
+#ifndef CBBOC_BUCKETELIMINATION_HPP
+#define CBBOC_BUCKETELIMINATION_HPP
+
+#include "PackedBitvector.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * The steps of bucket elimination shared by ExactSolver.hpp and
+ * MiniBucketBound.hpp: subfunctions as factors, the bucket each factor
+ * goes to along an elimination order, and the max-sum message that
+ * eliminates a variable from a set of factors.
+ */
+
+namespace cbboc_elimination {
+
+///////////////////////////////////
+
+// A table over the variables in scope, sorted; bit p of an index is
+// the value of scope[ p ].
+struct Factor {
+	std::vector< int > scope;
+	std::vector< double > table;
+};
+
+///////////////////////////////////
+
+// The factor of a subfunction reading variables vars[ 0 .. K ), most
+// significant first, through table, its scope sorted and repeats merged.
+inline Factor subfunctionFactor( const int* vars, int K, const double* table ) {
+	Factor result;
+	result.scope.assign( vars, vars + K );
+	std::sort( result.scope.begin(), result.scope.end() );
+	result.scope.erase( std::unique( result.scope.begin(), result.scope.end() ), result.scope.end() );
+
+	result.table.resize( size_t( 1 ) << result.scope.size() );
+	for( size_t u=0; u<result.table.size(); ++u ) {
+		size_t t = 0;
+		for( int j=0; j<K; ++j ) {
+			const size_t p = std::lower_bound( result.scope.begin(), result.scope.end(), vars[ j ] ) - result.scope.begin();
+			t = ( t << 1 ) | ( ( u >> p ) & 1 );
+		}
+		result.table[ u ] = table[ t ];
+	}
+	return result;
+}
+
+// The bucket a factor goes to: that of its first variable to be eliminated,
+// position[ v ] being the step at which v is.
+inline int bucketOf( const Factor& f, const std::vector< int >& position ) {
+	int result = -1;
+	for( size_t p=0; p<f.scope.size(); ++p )
+		if( result < 0 || position[ f.scope[ p ] ] < result )
+			result = position[ f.scope[ p ] ];
+	return result;
+}
+
+// Appends f to bucket, leaving f empty.
+inline void moveTo( std::vector< Factor >& bucket, Factor& f ) {
+	bucket.push_back( Factor() );
+	bucket.back().scope.swap( f.scope );
+	bucket.back().table.swap( f.table );
+}
+
+///////////////////////////////////
+
+// The message that maximizes v out of the sum of the factors in part.
+// If argmax is given, it is set to the best value of v for each entry
+// of the message, ties going to false.
+inline Factor eliminate( const std::vector< Factor >& part, int v, std::vector< bool >* argmax = nullptr ) {
+	Factor message;
+	for( size_t f=0; f<part.size(); ++f )
+		for( size_t p=0; p<part[ f ].scope.size(); ++p )
+			if( part[ f ].scope[ p ] != v )
+				message.scope.push_back( part[ f ].scope[ p ] );
+	std::sort( message.scope.begin(), message.scope.end() );
+	message.scope.erase( std::unique( message.scope.begin(), message.scope.end() ), message.scope.end() );
+
+	// flips[ b ][ f ] is the bit of factor f's index that bit b of the
+	// message index sets, if any; vBits[ f ] the one v sets.
+	const int d = static_cast< int >( message.scope.size() );
+	std::vector< std::vector< size_t > > flips( d, std::vector< size_t >( part.size(), 0 ) );
+	std::vector< size_t > vBits( part.size(), 0 ), indices( part.size(), 0 );
+	for( size_t f=0; f<part.size(); ++f )
+		for( size_t p=0; p<part[ f ].scope.size(); ++p ) {
+			if( part[ f ].scope[ p ] == v )
+				vBits[ f ] = size_t( 1 ) << p;
+			else
+				flips[ std::lower_bound( message.scope.begin(), message.scope.end(), part[ f ].scope[ p ] )
+					- message.scope.begin() ][ f ] = size_t( 1 ) << p;
+		}
+
+	// Assignments are visited in Gray-code order, so that each step
+	// changes one variable and updates factor indices by a flip.
+	const size_t messageSize = size_t( 1 ) << d;
+	message.table.resize( messageSize );
+	if( argmax )
+		argmax->assign( messageSize, false );
+	for( size_t g=0; g<messageSize; ++g ) {
+		if( g > 0 ) {
+			const std::vector< size_t >& flip = flips[ countTrailingZeros64( g ) ];
+			for( size_t f=0; f<part.size(); ++f )
+				indices[ f ] ^= flip[ f ];
+		}
+
+		double sums[ 2 ] = { 0.0, 0.0 };
+		for( size_t f=0; f<part.size(); ++f ) {
+			sums[ 0 ] += part[ f ].table[ indices[ f ] ];
+			sums[ 1 ] += part[ f ].table[ indices[ f ] | vBits[ f ] ];
+		}
+		const size_t u = g ^ ( g >> 1 );
+		if( argmax )
+			( *argmax )[ u ] = sums[ 1 ] > sums[ 0 ];
+		message.table[ u ] = std::max( sums[ 0 ], sums[ 1 ] );
+	}
+	return message;
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_elimination {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
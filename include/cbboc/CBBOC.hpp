@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <ctime>
 #include <iostream>
 #include <iterator>
@@ -41,7 +42,10 @@ class CBBOC {
 
 public:
 
-	static void run( Competitor& client )	{
+	// With streamTesting, testing instances are loaded in the background
+	// while the client is tested on earlier ones, and each is released
+	// once its result is recorded ( see ProblemClass::TestingStream ).
+	static void run( Competitor& client, bool streamTesting = false )	{
 
 		const std::string root = "./resources/";
 		const std::string problemClassFile = root + "classFolder.txt";
@@ -50,15 +54,18 @@ public:
 		if( lines.empty() )
 			throw std::runtime_error( "bad format for classFolder.txt" );
 
+		// The name of a class folder or of a class archive ( see ClassArchive.hpp ).
 		const std::string problemClassName = lines.front();
 		const std::string problemFolder( root + problemClassName );
-		ProblemClass problemClass( problemFolder, client.getTrainingCategory() );
+		ProblemClass problemClass( problemFolder, client.getTrainingCategory(), 0,
+			streamTesting ? ProblemClass::STREAM_TESTING : ProblemClass::LOAD_TESTING );
 		
 		long long actualTestingTime = -1, actualTrainingTime = -1;
+		std::vector< Result > testingResults;
 
 		switch( client.getTrainingCategory() ) {
 			case TrainingCategory::NONE : {
-				actualTestingTime = testClient( client, problemClass.getTestingInstances() );
+				actualTestingTime = testClient( client, problemClass, testingResults );
 				std::clog << "actualTestingTime:" << actualTestingTime << std::endl;
 			} break;
 			case TrainingCategory::SHORT :
@@ -66,7 +73,7 @@ public:
 				actualTrainingTime = trainClient( client, problemClass.getTrainingInstances() );
 				std::clog <<"actualTrainingTime:" << actualTrainingTime << std::endl;
 				
-				actualTestingTime = testClient( client, problemClass.getTestingInstances() );
+				actualTestingTime = testClient( client, problemClass, testingResults );
 				std::clog <<"actualTestingTime:" << actualTestingTime << std::endl;	
 			} break;
 			default : 
@@ -83,9 +90,10 @@ public:
 		const std::string timestamp( buffer );
 
 		const std::string className = classname( client );
-		OutputResults results( className, timestamp, problemClassName, problemClass, actualTrainingTime, actualTestingTime );
+		OutputResults results( className, timestamp, problemClassName, problemClass, testingResults, actualTrainingTime, actualTestingTime );
 
-		std::string outputPath = problemFolder + "/results/";
+		// An archive has no results folder, so results go beside it.
+		std::string outputPath = problemClass.isArchive() ? root : problemFolder + "/results/";
 		outputPath += "CBBOCresults-" + className + "-" + problemClassName + "-" + timestamp + ".json";
 		std::ofstream out( outputPath );
 		out << results.toJSonString() << std::endl;
@@ -163,10 +171,40 @@ private:
 		const long remainingEvaluations;
 		const long remainingEvaluationsWhenBestReached;
 		const double bestValue;
+		const double upperBound;
 
-		Result( long _remainingEvaluations, long _remainingEvaluationsWhenBestReached, double _bestValue )
+		Result( long _remainingEvaluations, long _remainingEvaluationsWhenBestReached, double _bestValue, double _upperBound )
 		: remainingEvaluations( _remainingEvaluations ),
-		  remainingEvaluationsWhenBestReached( _remainingEvaluationsWhenBestReached), bestValue( _bestValue ) {}
+		  remainingEvaluationsWhenBestReached( _remainingEvaluationsWhenBestReached), bestValue( _bestValue ),
+		  upperBound( _upperBound ) {}
+
+		bool hasBestValue() const { return remainingEvaluationsWhenBestReached >= 0; }
+
+		// Whether gap() is defined: there is a best value to compare, and a
+		// nonzero bound to scale by.
+		bool hasGap() const { return hasBestValue() && upperBound != 0.0; }
+
+		// ( upperBound - bestValue ) / |upperBound|: 0 at the bound, and
+		// comparable across instances of different scales.
+		double gap() const { return ( upperBound - bestValue ) / std::fabs( upperBound ); }
+
+		static Result of( const ObjectiveFn& o ) {
+			const auto p = o.getRemainingEvaluationsAtBestValue();
+			return Result( o.getRemainingEvaluations(), p.first, p.second, o.getUpperBound() );
+		}
+
+		jsoncons::json toJSon() const {
+			jsoncons::json result;
+			result["remainingEvaluations"] = remainingEvaluations;
+			result["remainingEvaluationsWhenBestReached"] = remainingEvaluationsWhenBestReached;
+			result["bestValue"] = bestValue;
+			result["upperBound"] = upperBound;
+			if( hasGap() )
+				result["gap"] = gap();
+			else
+				result["gap"] = jsoncons::json( jsoncons::null_type() );
+			return result;
+		}
 	};
 
 	class OutputResults {
@@ -187,6 +225,7 @@ private:
 		OutputResults( const std::string& _competitorName, const std::string& _datetime,
 			const std::string& _problemClassName,
 			const ProblemClass& problemClass,
+			const std::vector< Result >& _testingResults,
 			long _trainingWallClockUsage,
 			long _testingWallClockUsage )
 		: competitorName( _competitorName ),
@@ -195,19 +234,11 @@ private:
 		  trainingCategory( problemClass.getTrainingCategory() ),
 		  datetime( _datetime ),
 		  trainingWallClockUsage( _trainingWallClockUsage ),
+		  testingResults( _testingResults ),
 		  testingWallClockUsage( _testingWallClockUsage )
 		{
-			for( size_t i=0; i<problemClass.getTrainingInstances().size(); ++i ) {
-				const ObjectiveFn& o = problemClass.getTrainingInstances()[ i ];
-				const auto p = o.getRemainingEvaluationsAtBestValue();
-				trainingResults.push_back( Result( o.getRemainingEvaluations(), p.first, p.second ) );
-			}
-
-			for( size_t i=0; i<problemClass.getTestingInstances().size(); ++i ) {
-				const ObjectiveFn& o = problemClass.getTestingInstances()[ i ];
-				const auto p = o.getRemainingEvaluationsAtBestValue();
-				testingResults.push_back( Result( o.getRemainingEvaluations(), p.first, p.second ) );
-			}
+			for( size_t i=0; i<problemClass.getTrainingInstances().size(); ++i )
+				trainingResults.push_back( Result::of( problemClass.getTrainingInstances()[ i ] ) );
 		}
 
 		const std::vector< Result >& getTestingResults() const { return testingResults; }
@@ -219,24 +250,12 @@ private:
 			jsoncons::json result;
 
 			jsoncons::json training( jsoncons::json::an_array );
-			for( size_t i=0; i<trainingResults.size(); ++i ) {
-				const Result& r = trainingResults[ i ];
-				jsoncons::json elem;
-				elem["remainingEvaluations"] = r.remainingEvaluations;
-				elem["remainingEvaluationsWhenBestReached"] = r.remainingEvaluationsWhenBestReached;
-				elem["bestValue"] = r.bestValue;
-				training.add( elem );
-			}
+			for( size_t i=0; i<trainingResults.size(); ++i )
+				training.add( trainingResults[ i ].toJSon() );
 
 			jsoncons::json testing( jsoncons::json::an_array );
-			for( size_t i=0; i<testingResults.size(); ++i ) {
-				const Result& r = testingResults[ i ];
-				jsoncons::json elem;
-				elem["remainingEvaluations"] = r.remainingEvaluations;
-				elem["remainingEvaluationsWhenBestReached"] = r.remainingEvaluationsWhenBestReached;
-				elem["bestValue"] = r.bestValue;
-				testing.add( elem );
-			}
+			for( size_t i=0; i<testingResults.size(); ++i )
+				testing.add( testingResults[ i ].toJSon() );
 
 			result["competitorName"] = competitorName;
 			result["competitorLanguage"] = competitorLanguage;
@@ -260,22 +279,39 @@ private:
 
 	///////////////////////////////
 
-	static long long testClient( Competitor& client, std::vector< ObjectiveFn >& fns ) {
-		const long long startTime = system_current_time_millis();		
+	static void testClient( Competitor& client, ObjectiveFn& o ) {
+		try {
+			const long long now = system_current_time_millis();
+			testingEndTime() = now + BASE_TIME_PER_INSTANCE_IN_MILLIS;
 
-		for( size_t i=0; i<fns.size(); ++i ) {
-			try {
-				const long long now = system_current_time_millis();
-				testingEndTime() = now + BASE_TIME_PER_INSTANCE_IN_MILLIS;
+			client.test( o, BASE_TIME_PER_INSTANCE_IN_MILLIS );
+		}
+		catch( EvaluationsExceededException& ) {
+			// Intentionally empty
+		}
+		catch( TimeExceededException& ) {
+			// Intentionally empty
+		}
+	}
 
-				ObjectiveFn& o = fns[ i ];
-				client.test( o, BASE_TIME_PER_INSTANCE_IN_MILLIS );
-			}
-			catch( EvaluationsExceededException& ) {
-				// Intentionally empty
+	// Tests the client on each testing instance in turn, appending their 
+	// results to results. Streamed instances are released as soon as 
+	// their result is recorded.
+	static long long testClient( Competitor& client, ProblemClass& problemClass, std::vector< Result >& results ) {
+		const long long startTime = system_current_time_millis();		
+
+		if( problemClass.isStreamingTesting() ) {
+			const std::unique_ptr< ProblemClass::TestingStream > stream = problemClass.openTestingStream();
+			for( std::unique_ptr< ObjectiveFn > o = stream->next(); o != nullptr; o = stream->next() ) {
+				testClient( client, *o );
+				results.push_back( Result::of( *o ) );
 			}
-			catch( TimeExceededException& ) {
-				// Intentionally empty
+		}
+		else {
+			std::vector< ObjectiveFn >& fns = problemClass.getTestingInstances();
+			for( size_t i=0; i<fns.size(); ++i ) {
+				testClient( client, fns[ i ] );
+				results.push_back( Result::of( fns[ i ] ) );
 			}
 		}
 		
@@ -335,24 +371,37 @@ private:
 //////////////////////////////////////////////////////////////////////
 
 inline
-double ObjectiveFn::value( const std::vector< bool >& candidate ) {
+bool ObjectiveFn::deadlinePassed() const {
 
 	// Included in CBBOC.hpp in order to resolve the 
 	// dependency between ObjectiveFn and CBBOC to be resolved
 	// in a way that allows `header file only' compilation.
 
 	const long long timeNow = system_current_time_millis();
-	if( timingMode == TimingMode::TRAINING ) {
-		if( timeNow > CBBOC::trainingEndTime() )
-			throw CBBOC::TimeExceededException();
-	}
-	else if( timingMode == TimingMode::TESTING ) {
-		if( timeNow > CBBOC::testingEndTime() )
-			throw CBBOC::TimeExceededException();
-	}
-	else {
+	if( timingMode == TimingMode::TRAINING )
+		return timeNow > CBBOC::trainingEndTime();
+	else if( timingMode == TimingMode::TESTING )
+		return timeNow > CBBOC::testingEndTime();
+	else
 		throw std::logic_error( "invalid timingMode in ObjectiveFn.value" );
+}
+
+inline
+void ObjectiveFn::recordValue( long remainingEvaluationsNow, double value ) {
+	// We are maximizing...
+	if( remainingEvaluationsAtBestValue == nullptr )
+		remainingEvaluationsAtBestValue.reset( new std::pair< long, double >( remainingEvaluationsNow, value ) );
+	else if( value > remainingEvaluationsAtBestValue->second ) {
+		*remainingEvaluationsAtBestValue = std::make_pair( remainingEvaluationsNow, value );
 	}
+}
+
+template < typename Candidate >
+inline
+double ObjectiveFn::evaluate( const Candidate& candidate ) {
+
+	if( deadlinePassed() )
+		throw CBBOC::TimeExceededException();
 		
 	///////////////////////////
 		
@@ -362,16 +411,70 @@ double ObjectiveFn::value( const std::vector< bool >& candidate ) {
 	else {
 		const double value = instance.value( candidate );
 		--*remainingEvaluations;
+		recordValue( getRemainingEvaluations(), value );
+		return value;
+	}
+}
 
-		// We are maximizing...
-		if( remainingEvaluationsAtBestValue == nullptr )
-			remainingEvaluationsAtBestValue.reset( new std::pair< long, double >( getRemainingEvaluations(), value ) );
-		else if( value > remainingEvaluationsAtBestValue->second ) {
-			*remainingEvaluationsAtBestValue = std::make_pair( getRemainingEvaluations(), value );
-		}
+template < typename Candidate >
+inline
+std::vector< double > ObjectiveFn::evaluateBatch( const std::vector< Candidate >& batch ) {
 
-		return value;
+	if( deadlinePassed() )
+		throw CBBOC::TimeExceededException();
+
+	if( *remainingEvaluations <= 0 )
+		throw CBBOC::EvaluationsExceededException();
+
+	///////////////////////////
+
+	// Reserve as much of the batch as the budget allows, checked up front
+	// so that a bad candidate fails the call before anything is charged.
+	const long startRemaining = *remainingEvaluations;
+	const size_t reserved = std::min< size_t >( batch.size(), static_cast< size_t >( startRemaining ) );
+	for( size_t i=0; i<reserved; ++i )
+		if( batch[ i ].size() != instance.getNumGenes() )
+			throw std::invalid_argument( "Bad argument to ObjectiveFn.values" );
+
+	// Evaluate it in chunks, re-reading the clock only between chunks,
+	// and charge and record each chunk as soon as it is evaluated.
+	const size_t chunkSize = BATCH_CHUNK_SIZE;
+	std::vector< double > result( reserved );
+	size_t done = 0;
+	while( done < reserved ) {
+		if( done > 0 && deadlinePassed() )
+			break;
+
+		const size_t n = std::min( chunkSize, reserved - done );
+		instance.values( batch.data() + done, n, result.data() + done );
+		for( size_t i=done; i<done + n; ++i )
+			recordValue( startRemaining - static_cast< long >( i + 1 ), result[ i ] );
+		done += n;
+		*remainingEvaluations = startRemaining - static_cast< long >( done );
 	}
+
+	result.resize( done );
+	return result;
+}
+
+inline
+double ObjectiveFn::value( const std::vector< bool >& candidate ) {
+	return evaluate( candidate );
+}
+
+inline
+double ObjectiveFn::value( const PackedBitvector& candidate ) {
+	return evaluate( candidate );
+}
+
+inline
+std::vector< double > ObjectiveFn::values( const std::vector< std::vector< bool > >& batch ) {
+	return evaluateBatch( batch );
+}
+
+inline
+std::vector< double > ObjectiveFn::values( const std::vector< PackedBitvector >& batch ) {
+	return evaluateBatch( batch );
 }
 
 //////////////////////////////////////////////////////////////////////
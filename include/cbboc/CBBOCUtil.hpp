@@ -1,6 +1,7 @@
 #ifndef CBBOC_CBBOCUTIL_HPP
 #define CBBOC_CBBOCUTIL_HPP
 
+#include "cbboc/PackedBitvector.hpp"
 #include "cbboc/RNG.hpp"
 
 #include <cstdio>
@@ -35,6 +36,13 @@ random_bitvector( int length ) {
 	return result;
 }
 
+inline PackedBitvector
+random_packed_bitvector( int length ) {
+	PackedBitvector result( length );
+	result.randomize();
+	return result;
+}
+
 /***
 // Get the appropriate string for separating directories on this file system
 const std::string directory_separator =
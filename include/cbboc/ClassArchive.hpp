@@ -0,0 +1,281 @@
+#ifndef CBBOC_CLASSARCHIVE_HPP
+#define CBBOC_CLASSARCHIVE_HPP
+
+#include "BinaryInstance.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Class archives: all the instances of a problem class in one file, in
+ * place of a class folder with its inventories.
+ *
+ * An archive is a 64-byte Header, the instances as binary instance
+ * images ( see BinaryInstance.hpp ), each starting at a multiple of
+ * cbboc_binary::ALIGNMENT bytes, and then the table of contents: an
+ * Entry per instance, training instances first, each in inventory
+ * order, followed by their names. The checksum covers the table of
+ * contents only; each image carries its own.
+ *
+ * Opening an archive reads just its header and table of contents, so
+ * instances are read one at a time as they are needed, either mapped in
+ * place ( MAP ) or read into memory of their own ( READ ).
+ */
+
+namespace cbboc_archive {
+
+///////////////////////////////////
+
+const char MAGIC[ 8 ] = { 'C', 'B', 'B', 'O', 'C', 'C', 'L', 'S' };
+const uint32_t VERSION = 1;
+
+struct Header {
+	char magic[ 8 ];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t fileSize;
+	uint64_t numTraining;
+	uint64_t numTesting;
+	uint64_t tocOffset;
+	uint64_t tocSize; // ^ entries and names together.
+	uint64_t checksum;
+};
+
+static_assert( sizeof( Header ) == 64, "unexpected padding in cbboc_archive::Header" );
+
+struct Entry {
+	uint64_t offset;
+	uint64_t size;
+	uint64_t nameOffset; // ^ from the start of the names.
+	uint64_t nameLength;
+};
+
+///////////////////////////////////
+
+inline bool isArchive( const std::string& path ) {
+	std::ifstream ifs( path.c_str(), std::ios::binary );
+	char magic[ sizeof( MAGIC ) ];
+	return ifs.read( magic, sizeof( magic ) ) && std::memcmp( magic, MAGIC, sizeof( MAGIC ) ) == 0;
+}
+
+///////////////////////////////////
+
+/**
+ * Writes an archive to a seekable stream: add() each instance in turn,
+ * training instances first, and then finish().
+ */
+
+class ArchiveWriter {
+
+	std::ostream& os;
+	std::vector< Entry > entries;
+	std::string names;
+	uint64_t numTraining;
+	uint64_t length;
+	bool finished;
+
+	void pad() {
+		const uint64_t aligned = ( length + cbboc_binary::ALIGNMENT - 1 ) / cbboc_binary::ALIGNMENT * cbboc_binary::ALIGNMENT;
+		const std::vector< char > zeros( aligned - length, 0 );
+		os.write( zeros.data(), static_cast< std::streamsize >( zeros.size() ) );
+		length = aligned;
+	}
+
+public:
+
+	explicit ArchiveWriter( std::ostream& os_ ) : os( os_ ), numTraining( 0 ), length( 0 ), finished( false ) {
+		Header header;
+		std::memset( &header, 0, sizeof( header ) );
+		os.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+		length = sizeof( header );
+	}
+
+	// Appends image, a binary instance image, as the instance name.
+	void add( const std::string& name, const std::string& image, bool training ) {
+		if( finished || ( training && entries.size() != numTraining ) )
+			throw std::invalid_argument( "Bad argument to ArchiveWriter.add" );
+
+		pad();
+		Entry entry;
+		entry.offset = length;
+		entry.size = image.size();
+		entry.nameOffset = names.size();
+		entry.nameLength = name.size();
+		entries.push_back( entry );
+		names += name;
+		if( training )
+			++numTraining;
+
+		os.write( image.data(), static_cast< std::streamsize >( image.size() ) );
+		length += image.size();
+		if( !os )
+			throw std::runtime_error( "error writing class archive" );
+	}
+
+	// Writes the table of contents and the header.
+	void finish() {
+		if( finished )
+			throw std::invalid_argument( "Bad argument to ArchiveWriter.finish" );
+		finished = true;
+
+		pad();
+		std::string toc( entries.size() * sizeof( Entry ), '\0' );
+		if( !entries.empty() )
+			std::memcpy( &toc[ 0 ], entries.data(), toc.size() );
+		toc += names;
+		toc.resize( ( toc.size() + 7 ) / 8 * 8, '\0' );
+
+		Header header;
+		std::memset( &header, 0, sizeof( header ) );
+		std::memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+		header.version = VERSION;
+		header.byteOrder = cbboc_binary::BYTE_ORDER_MARK;
+		header.numTraining = numTraining;
+		header.numTesting = entries.size() - numTraining;
+		header.tocOffset = length;
+		header.tocSize = toc.size();
+		header.fileSize = length + toc.size();
+		header.checksum = cbboc_binary::checksumOf( toc.data(), toc.size() );
+
+		os.write( toc.data(), static_cast< std::streamsize >( toc.size() ) );
+		os.seekp( 0 );
+		os.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+		os.seekp( 0, std::ios::end );
+		if( !os )
+			throw std::runtime_error( "error writing class archive" );
+	}
+};
+
+///////////////////////////////////
+
+/**
+ * An archive opened for reading. Instances are numbered training first,
+ * so testing instance i is instance numTraining() + i. It can be read
+ * from several threads at once.
+ */
+
+class ClassArchive {
+public:
+
+	enum Access { MAP, READ };
+
+private:
+
+	std::string path;
+	Access access;
+	Header header;
+	std::vector< Entry > entries;
+	std::vector< std::string > names;
+	std::shared_ptr< const MappedFile > file; // ^ with MAP only.
+
+	void fail( const std::string& message ) const {
+		throw std::runtime_error( "bad class archive " + path + ": " + message );
+	}
+
+	void readAt( uint64_t offset, char* buffer, uint64_t size ) const {
+		std::ifstream ifs( path.c_str(), std::ios::binary );
+		ifs.seekg( static_cast< std::streamoff >( offset ) );
+		if( !ifs.read( buffer, static_cast< std::streamsize >( size ) ) )
+			fail( "truncated" );
+	}
+
+public:
+
+	explicit ClassArchive( const std::string& path_, Access access_ = MAP ) : path( path_ ), access( access_ ) {
+		uint64_t size = 0;
+		if( access == MAP ) {
+			file = std::make_shared< const MappedFile >( path );
+			size = file->size();
+		}
+		else {
+			int64_t modified = 0;
+			if( !cbboc_binary::fileInfo( path, size, modified ) )
+				throw std::runtime_error( "cannot open " + path );
+		}
+
+		if( size < sizeof( Header ) )
+			fail( "too short" );
+		if( file )
+			std::memcpy( &header, file->data(), sizeof( header ) );
+		else
+			readAt( 0, reinterpret_cast< char* >( &header ), sizeof( header ) );
+
+		if( std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) != 0 )
+			fail( "not a class archive" );
+		if( header.version != VERSION || header.byteOrder != cbboc_binary::BYTE_ORDER_MARK )
+			fail( "unsupported version or byte order" );
+		if( header.fileSize != size || header.tocOffset < sizeof( Header ) || header.tocOffset > size ||
+			header.tocSize != size - header.tocOffset || header.tocSize % 8 != 0 ||
+			header.numTraining > header.tocSize / sizeof( Entry ) ||
+			header.numTesting > header.tocSize / sizeof( Entry ) - header.numTraining )
+			fail( "inconsistent table of contents" );
+
+		std::vector< char > toc( header.tocSize );
+		if( file )
+			std::memcpy( toc.data(), file->data() + header.tocOffset, toc.size() );
+		else if( !toc.empty() )
+			readAt( header.tocOffset, toc.data(), toc.size() );
+		if( cbboc_binary::checksumOf( toc.data(), toc.size() ) != header.checksum )
+			fail( "checksum mismatch" );
+
+		entries.resize( header.numTraining + header.numTesting );
+		if( !entries.empty() )
+			std::memcpy( entries.data(), toc.data(), entries.size() * sizeof( Entry ) );
+		const uint64_t namesSize = toc.size() - entries.size() * sizeof( Entry );
+		const char* namesBegin = toc.data() + entries.size() * sizeof( Entry );
+		for( size_t i=0; i<entries.size(); ++i ) {
+			const Entry& e = entries[ i ];
+			if( e.offset < sizeof( Header ) || e.offset % cbboc_binary::ALIGNMENT != 0 ||
+				e.offset > header.tocOffset || e.size > header.tocOffset - e.offset ||
+				e.nameOffset > namesSize || e.nameLength > namesSize - e.nameOffset )
+				fail( "entry out of range" );
+			names.push_back( std::string( namesBegin + e.nameOffset, e.nameLength ) );
+		}
+	}
+
+	///////////////////////////////
+
+	const std::string& getPath() const { return path; }
+	Access getAccess() const { return access; }
+
+	size_t size() const { return entries.size(); }
+	size_t numTraining() const { return header.numTraining; }
+	size_t numTesting() const { return header.numTesting; }
+
+	// The name of instance i, as in the inventory it came from.
+	const std::string& name( size_t i ) const { return names.at( i ); }
+
+	// The image of instance i, mapped in place or read, as for
+	// cbboc_binary::mapInstance(). Errors name the archive and instance.
+	cbboc_binary::MappedInstance instance( size_t i, bool verifyChecksum = false ) const {
+		const Entry& e = entries.at( i );
+		const std::string where = path + ":" + names[ i ];
+		if( file )
+			return cbboc_binary::mapInstance( file->data() + e.offset, e.size, file, where, verifyChecksum );
+
+		// In words, for alignment.
+		std::shared_ptr< std::vector< uint64_t > > buffer = std::make_shared< std::vector< uint64_t > >( ( e.size + 7 ) / 8 );
+		if( e.size > 0 )
+			readAt( e.offset, reinterpret_cast< char* >( buffer->data() ), e.size );
+		return cbboc_binary::mapInstance( reinterpret_cast< const char* >( buffer->data() ), e.size, buffer, where, verifyChecksum );
+	}
+};
+
+///////////////////////////////////
+
+} // namespace cbboc_archive {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
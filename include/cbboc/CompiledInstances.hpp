@@ -0,0 +1,54 @@
+#ifndef CBBOC_COMPILEDINSTANCES_HPP
+#define CBBOC_COMPILEDINSTANCES_HPP
+
+#include "PackedBitvector.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Registry of evaluators generated ahead of time by the instance
+ * compiler ( see InstanceCompiler.hpp and tools/CompileInstance.cpp ).
+ *
+ * A generated source file registers its evaluator during static
+ * initialization, keyed by the fingerprint of the instance it was
+ * generated from, along with that instance's data. Any ProblemInstance
+ * loaded with the same fingerprint and exactly the same data then
+ * evaluates through it, and so does every ObjectiveFn built on it; the
+ * data is compared in full, since fingerprints can collide.
+ */
+
+struct CompiledInstance {
+	uint64_t fingerprint;
+	size_t numGenes;
+	int K;
+	int M;
+	const int* vars; // ^ K per subfunction.
+	const int* tableOffsets; // ^ into pool, one per subfunction.
+	const double* pool;
+	size_t poolSize;
+	double ( *bitvectorValue )( const std::vector< bool >& candidate );
+	double ( *packedValue )( const PackedBitvector& candidate );
+};
+
+///////////////////////////////////
+
+inline std::vector< CompiledInstance >& compiledInstances() {
+	static std::vector< CompiledInstance > result;
+	return result;
+}
+
+struct CompiledInstanceRegistration {
+	explicit CompiledInstanceRegistration( const CompiledInstance& compiled ) {
+		compiledInstances().push_back( compiled );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,231 @@
+#ifndef CBBOC_EXACTSOLVER_HPP
+#define CBBOC_EXACTSOLVER_HPP
+
+#include "BucketElimination.hpp"
+#include "ProblemInstance.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Exact maximization of a ProblemInstance by variable elimination.
+ *
+ * The variables are ordered by the min-fill heuristic on the interaction
+ * graph ( variables adjacent when some subfunction reads both ), which
+ * implicitly gives a tree decomposition whose width is the largest
+ * number of neighbours any variable has when it is eliminated. Max-sum
+ * dynamic programming along that order then costs time and memory
+ * exponential in the width only, rather than in the number of variables,
+ * so low-width classes such as sample3 ( n=143, K=2 ) solve in moments.
+ *
+ * The constructor computes the order and fails fast, throwing
+ * std::runtime_error before any table is built, if the width exceeds
+ * MAX_WIDTH or the tables the elimination needs would exceed
+ * memoryBudget bytes. Ties between optima are broken towards false,
+ * and the returned value is recomputed with ProblemInstance::value.
+ * The elimination steps are those of BucketElimination.hpp.
+ */
+
+class ExactSolver {
+public:
+
+	struct Result {
+		std::vector< bool > best;
+		double bestValue;
+	};
+
+	static const size_t DEFAULT_MEMORY_BUDGET = size_t( 1 ) << 30;
+	static const int MAX_WIDTH = 40;
+
+private:
+
+	const ProblemInstance& instance;
+	size_t memoryBudget;
+
+	std::vector< int > order;
+	std::vector< int > position;
+	int width;
+	double estimatedMemory;
+
+	///////////////////////////////
+
+	typedef std::pair< std::pair< size_t, size_t >, int > Score;
+
+	static Score scoreOf( const std::vector< std::set< int > >& adjacent, int v ) {
+		const std::set< int >& neighbours = adjacent[ v ];
+		size_t fill = 0;
+		for( std::set< int >::const_iterator a = neighbours.begin(); a != neighbours.end(); ++a )
+			for( std::set< int >::const_iterator b = a; ++b != neighbours.end(); )
+				if( !adjacent[ *a ].count( *b ) )
+					++fill;
+		return Score( std::make_pair( fill, neighbours.size() ), v );
+	}
+
+	// Min-fill order ( ties to fewest neighbours, then lowest index ),
+	// checking the width as it goes; returns the neighbours of each
+	// variable when it is eliminated, in elimination order.
+	std::vector< std::vector< int > > computeOrder() {
+		const int n = static_cast< int >( instance.getNumGenes() );
+		const int K = instance.getK();
+		const std::vector< int > varIndices = instance.getVarIndices();
+
+		std::vector< std::set< int > > adjacent( n );
+		for( int i=0; i<instance.getM(); ++i )
+			for( int j=0; j<K; ++j )
+				for( int k=0; k<K; ++k ) {
+					const int a = varIndices[ i * K + j ], b = varIndices[ i * K + k ];
+					if( a != b )
+						adjacent[ a ].insert( b );
+				}
+
+		std::vector< Score > scores( n );
+		std::set< Score > queue;
+		for( int v=0; v<n; ++v ) {
+			scores[ v ] = scoreOf( adjacent, v );
+			queue.insert( scores[ v ] );
+		}
+
+		position.assign( n, -1 );
+		std::vector< std::vector< int > > scopes( n );
+		while( !queue.empty() ) {
+			const int v = queue.begin()->second;
+			queue.erase( queue.begin() );
+			position[ v ] = static_cast< int >( order.size() );
+			order.push_back( v );
+
+			const std::vector< int > neighbours( adjacent[ v ].begin(), adjacent[ v ].end() );
+			const int degree = static_cast< int >( neighbours.size() );
+			width = std::max( width, degree );
+			if( width > MAX_WIDTH )
+				throw std::runtime_error( "Treewidth too large for ExactSolver" );
+
+			scopes[ position[ v ] ] = neighbours;
+
+			std::set< int > changed( neighbours.begin(), neighbours.end() );
+			for( size_t a=0; a<neighbours.size(); ++a ) {
+				adjacent[ neighbours[ a ] ].erase( v );
+				for( size_t b=0; b<neighbours.size(); ++b )
+					if( a != b )
+						adjacent[ neighbours[ a ] ].insert( neighbours[ b ] );
+			}
+			for( size_t a=0; a<neighbours.size(); ++a )
+				changed.insert( adjacent[ neighbours[ a ] ].begin(), adjacent[ neighbours[ a ] ].end() );
+			std::set< int >().swap( adjacent[ v ] );
+
+			for( std::set< int >::const_iterator w = changed.begin(); w != changed.end(); ++w ) {
+				if( position[ *w ] >= 0 )
+					continue;
+				queue.erase( scores[ *w ] );
+				scores[ *w ] = scoreOf( adjacent, *w );
+				queue.insert( scores[ *w ] );
+			}
+		}
+		return scopes;
+	}
+
+	// Peak bytes held during solve(), from the largest possible message
+	// scopes: each message lives until the bucket it goes to has been
+	// processed, and each argmax table, one bit per entry, to the end.
+	double peakMemory( const std::vector< std::vector< int > >& scopes ) const {
+		const size_t n = scopes.size();
+		std::vector< double > freed( n, 0.0 );
+		double live = 0.0, result = 0.0;
+		for( size_t step=0; step<n; ++step ) {
+			const double entries = std::ldexp( 1.0, static_cast< int >( scopes[ step ].size() ) );
+			live += entries * ( sizeof( double ) + 1.0 / 8 );
+			result = std::max( result, live );
+			live -= freed[ step ];
+
+			int consumer = -1;
+			for( size_t p=0; p<scopes[ step ].size(); ++p )
+				if( consumer < 0 || position[ scopes[ step ][ p ] ] < consumer )
+					consumer = position[ scopes[ step ][ p ] ];
+			if( consumer < 0 )
+				live -= entries * sizeof( double );
+			else
+				freed[ consumer ] += entries * sizeof( double );
+		}
+		return result;
+	}
+
+	///////////////////////////////
+
+public:
+
+	explicit ExactSolver( const ProblemInstance& instance_, size_t memoryBudget_ = DEFAULT_MEMORY_BUDGET )
+	: instance( instance_ ), memoryBudget( memoryBudget_ ), width( 0 ), estimatedMemory( 0.0 ) {
+		estimatedMemory = peakMemory( computeOrder() );
+		if( estimatedMemory > double( memoryBudget ) )
+			throw std::runtime_error( "ExactSolver would exceed its memory budget" );
+	}
+
+	///////////////////////////////
+
+	// The width of the tree decomposition, i.e. one less than its largest bag.
+	int getWidth() const { return width; }
+
+	// Upper bound on the bytes of tables solve() holds at once.
+	double getEstimatedMemory() const { return estimatedMemory; }
+
+	const std::vector< int >& getEliminationOrder() const { return order; }
+
+	///////////////////////////////
+
+	Result solve() const {
+		const size_t n = instance.getNumGenes();
+		const std::vector< int > varIndices = instance.getVarIndices();
+		const int K = instance.getK();
+		const size_t tableSize = size_t( 1 ) << K;
+
+		using namespace cbboc_elimination;
+		std::vector< std::vector< Factor > > buckets( n );
+		std::vector< double > table( tableSize );
+		for( int i=0; i<instance.getM(); ++i ) {
+			for( size_t t=0; t<tableSize; ++t )
+				table[ t ] = instance.fnTableEntry( i, t );
+			Factor f = subfunctionFactor( varIndices.data() + i * K, K, table.data() );
+			moveTo( buckets[ bucketOf( f, position ) ], f );
+		}
+
+		// For each eliminated variable, the scope of its message and the
+		// best value of the variable for each assignment of that scope.
+		std::vector< std::vector< int > > argmaxScopes( n );
+		std::vector< std::vector< bool > > argmax( n );
+
+		for( size_t step=0; step<n; ++step ) {
+			const int v = order[ step ];
+			Factor message = eliminate( buckets[ step ], v, &argmax[ v ] );
+			std::vector< Factor >().swap( buckets[ step ] );
+
+			argmaxScopes[ v ] = message.scope;
+			if( !message.scope.empty() )
+				moveTo( buckets[ bucketOf( message, position ) ], message );
+		}
+
+		// Variables in a message scope are eliminated later, so are set first.
+		Result result;
+		result.best.assign( n, false );
+		for( size_t step=n; step-- > 0; ) {
+			const int v = order[ step ];
+			size_t u = 0;
+			for( size_t p=0; p<argmaxScopes[ v ].size(); ++p )
+				u |= size_t( result.best[ argmaxScopes[ v ][ p ] ] ) << p;
+			result.best[ v ] = argmax[ v ][ u ];
+		}
+		result.bestValue = instance.value( result.best );
+		return result;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,229 @@
+#ifndef CBBOC_FUSEDEVALUATOR_HPP
+#define CBBOC_FUSEDEVALUATOR_HPP
+
+#include "PackedBitvector.hpp"
+#include "ProblemInstance.hpp"
+#include "ValueKernels.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Evaluates a ProblemInstance whose overlapping subfunctions have been
+ * fused into wider lookup tables. Two K=3 subfunctions sharing two
+ * variables, for instance, become one table over 4 variables, so one
+ * index build and one lookup replace two of each.
+ *
+ * Fusion is greedy: taking the groups in subfunction order, each absorbs
+ * the overlapping group with which it shares the most variables (then
+ * the one giving the narrowest table, then the first) for as long as the
+ * fused width stays within maxWidth variables. Each fused table holds,
+ * for every assignment of its variables, the sum of its members' entries
+ * in subfunction order, so values agree with ProblemInstance::value to
+ * within rounding.
+ *
+ * Tables grow to at most 2^maxWidth entries each; the evaluator keeps
+ * its own copy of everything and does not refer back to the instance.
+ */
+
+class FusedEvaluator {
+
+	size_t numGenes;
+	int maxWidth;
+
+	// Group g reads variables vars[ varOffsets[ g ] .. varOffsets[ g + 1 ] ),
+	// sorted, and has a table of 2^width entries at tableOffsets[ g ].
+	std::vector< int > varOffsets;
+	std::vector< int > vars;
+	std::vector< size_t > tableOffsets;
+	std::vector< double > tables;
+
+	///////////////////////////////
+
+	static std::vector< int > distinctVariables( const std::vector< int >& varIndices, int i, int K ) {
+		std::vector< int > result( varIndices.begin() + i * K, varIndices.begin() + ( i + 1 ) * K );
+		std::sort( result.begin(), result.end() );
+		result.erase( std::unique( result.begin(), result.end() ), result.end() );
+		return result;
+	}
+
+	static size_t numShared( const std::vector< int >& a, const std::vector< int >& b ) {
+		size_t result = 0;
+		for( std::vector< int >::const_iterator i = a.begin(), j = b.begin(); i != a.end() && j != b.end(); ) {
+			if( *i < *j )
+				++i;
+			else if( *j < *i )
+				++j;
+			else {
+				++result;
+				++i;
+				++j;
+			}
+		}
+		return result;
+	}
+
+	///////////////////////////////
+
+	void fuse( const ProblemInstance& instance ) {
+		const int K = instance.getK();
+		const int M = instance.getM();
+		const std::vector< int > varIndices = instance.getVarIndices();
+
+		std::vector< std::vector< int > > groupVars( M ), members( M );
+		std::vector< std::vector< int > > readers( numGenes );
+		std::vector< char > alive( M, 1 );
+		for( int i=0; i<M; ++i ) {
+			groupVars[ i ] = distinctVariables( varIndices, i, K );
+			members[ i ].assign( 1, i );
+			for( size_t v=0; v<groupVars[ i ].size(); ++v )
+				readers[ groupVars[ i ][ v ] ].push_back( i );
+		}
+
+		for( int g=0; g<M; ++g ) {
+			if( !alive[ g ] )
+				continue;
+
+			for( ;; ) {
+				int best = -1;
+				size_t bestShared = 0, bestWidth = 0;
+				for( size_t v=0; v<groupVars[ g ].size(); ++v ) {
+					const std::vector< int >& candidates = readers[ groupVars[ g ][ v ] ];
+					for( size_t c=0; c<candidates.size(); ++c ) {
+						const int h = candidates[ c ];
+						if( h == g || !alive[ h ] )
+							continue;
+
+						const size_t shared = numShared( groupVars[ g ], groupVars[ h ] );
+						const size_t width = groupVars[ g ].size() + groupVars[ h ].size() - shared;
+						if( width > static_cast< size_t >( maxWidth ) )
+							continue;
+
+						if( best < 0 || shared > bestShared || ( shared == bestShared &&
+							( width < bestWidth || ( width == bestWidth && h < best ) ) ) ) {
+							best = h;
+							bestShared = shared;
+							bestWidth = width;
+						}
+					}
+				}
+				if( best < 0 )
+					break;
+
+				for( size_t v=0; v<groupVars[ best ].size(); ++v )
+					if( !std::binary_search( groupVars[ g ].begin(), groupVars[ g ].end(), groupVars[ best ][ v ] ) )
+						readers[ groupVars[ best ][ v ] ].push_back( g );
+
+				std::vector< int > fused;
+				std::set_union( groupVars[ g ].begin(), groupVars[ g ].end(),
+					groupVars[ best ].begin(), groupVars[ best ].end(), std::back_inserter( fused ) );
+				groupVars[ g ].swap( fused );
+
+				std::vector< int > fusedMembers;
+				std::merge( members[ g ].begin(), members[ g ].end(),
+					members[ best ].begin(), members[ best ].end(), std::back_inserter( fusedMembers ) );
+				members[ g ].swap( fusedMembers );
+				alive[ best ] = 0;
+			}
+		}
+
+		// Entry u of a group sets its variable p to bit width-1-p of u.
+		std::vector< char > assignment( numGenes, 0 );
+		varOffsets.assign( 1, 0 );
+		for( int g=0; g<M; ++g ) {
+			if( !alive[ g ] )
+				continue;
+
+			const int width = static_cast< int >( groupVars[ g ].size() );
+			vars.insert( vars.end(), groupVars[ g ].begin(), groupVars[ g ].end() );
+			varOffsets.push_back( static_cast< int >( vars.size() ) );
+			tableOffsets.push_back( tables.size() );
+
+			const size_t tableSize = size_t( 1 ) << width;
+			for( size_t u=0; u<tableSize; ++u ) {
+				for( int p=0; p<width; ++p )
+					assignment[ groupVars[ g ][ p ] ] = static_cast< char >( ( u >> ( width - 1 - p ) ) & 1 );
+
+				double entry = 0.0;
+				for( size_t m=0; m<members[ g ].size(); ++m ) {
+					const int i = members[ g ][ m ];
+					size_t t = 0;
+					for( int j=0; j<K; ++j )
+						t = ( t << 1 ) | assignment[ varIndices[ i * K + j ] ];
+					entry += instance.fnTableEntry( i, t );
+				}
+				tables.push_back( entry );
+			}
+		}
+	}
+
+	template < typename Candidate >
+	double valueOf( const Candidate& candidate ) const {
+		double total = 0.0;
+		for( size_t g=0; g<tableOffsets.size(); ++g ) {
+			const int* v = vars.data() + varOffsets[ g ];
+			const int width = varOffsets[ g + 1 ] - varOffsets[ g ];
+			total += tables[ tableOffsets[ g ] + cbboc_kernels::tableIndex( candidate, v, width ) ];
+		}
+		return total;
+	}
+
+	template < typename Candidate >
+	void checkCandidate( const Candidate& candidate ) const {
+		if( candidate.size() != numGenes )
+			throw std::invalid_argument( "Bad argument to FusedEvaluator.value" );
+	}
+
+	///////////////////////////////
+
+public:
+
+	static const int DEFAULT_MAX_WIDTH = 8;
+	static const int MAX_WIDTH = 16;
+
+	explicit FusedEvaluator( const ProblemInstance& instance, int maxWidth_ = DEFAULT_MAX_WIDTH )
+	: numGenes( instance.getNumGenes() ), maxWidth( maxWidth_ ) {
+		if( maxWidth < 1 || maxWidth > MAX_WIDTH )
+			throw std::invalid_argument( "Bad maxWidth in FusedEvaluator" );
+
+		fuse( instance );
+	}
+
+	///////////////////////////////
+
+	size_t getNumGenes() const { return numGenes; }
+	int getMaxWidth() const { return maxWidth; }
+
+	// Number of fused subfunctions, and of entries in all their tables.
+	size_t getNumGroups() const { return tableOffsets.size(); }
+	size_t getNumTableEntries() const { return tables.size(); }
+
+	///////////////////////////////
+
+	double value( const std::vector< bool >& candidate ) const {
+		checkCandidate( candidate );
+		return valueOf( candidate );
+	}
+
+	double value( const PackedBitvector& candidate ) const {
+		checkCandidate( candidate );
+		return valueOf( candidate );
+	}
+
+	void values( const PackedBitvector* batch, size_t count, double* result ) const {
+		for( size_t c=0; c<count; ++c )
+			checkCandidate( batch[ c ] );
+		for( size_t c=0; c<count; ++c )
+			result[ c ] = valueOf( batch[ c ] );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,189 @@
+#ifndef CBBOC_GRAYCODEENUMERATOR_HPP
+#define CBBOC_GRAYCODEENUMERATOR_HPP
+
+#include "IncrementalEvaluator.hpp"
+#include "ProblemInstance.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Exhaustive search of all 2^n candidates of a small ProblemInstance.
+ *
+ * Candidates are visited in reflected Gray-code order, so consecutive
+ * candidates differ in a single variable and each step costs one
+ * IncrementalEvaluator::flip rather than a full evaluation. The sequence
+ * is cut into a fixed number of chunks ( depending only on n ), which
+ * worker threads take in turn; each chunk starts from a fresh
+ * evaluator and resynchronizes it every RESYNC_INTERVAL steps, which
+ * keeps accumulated rounding far below the precision of the tables.
+ *
+ * Results do not depend on the number of threads. The optimum is the
+ * first candidate in Gray-code order with the highest value, which is
+ * then recomputed with ProblemInstance::value. The optional value
+ * distribution maps each value, rounded to DISTRIBUTION_DECIMALS
+ * decimals, to the number of candidates that have it; it can be as
+ * large as the number of distinct values.
+ *
+ * Building with g++ on Linux needs -pthread.
+ */
+
+class GrayCodeEnumerator {
+public:
+
+	struct Result {
+		std::vector< bool > best;
+		double bestValue;
+		uint64_t numEvaluated;
+		std::map< double, uint64_t > distribution;
+	};
+
+	static const int MAX_NUM_GENES = 48;
+	static const int DISTRIBUTION_DECIMALS = 9;
+	static const uint64_t RESYNC_INTERVAL = 1 << 12;
+
+private:
+
+	const ProblemInstance& instance;
+	unsigned numThreads;
+
+	///////////////////////////////
+
+	struct ChunkResult {
+		uint64_t best;
+		double bestValue;
+		std::map< double, uint64_t > distribution;
+	};
+
+	static uint64_t grayCode( uint64_t i ) { return i ^ ( i >> 1 ); }
+
+	static double distributionKey( double value ) {
+		const double scale = 1e9; // ^ 10^DISTRIBUTION_DECIMALS
+		return std::floor( value * scale + 0.5 ) / scale;
+	}
+
+	// Visit candidates [ first, last ) of the Gray-code sequence.
+	ChunkResult enumerate( uint64_t first, uint64_t last, bool withDistribution ) const {
+		const size_t n = instance.getNumGenes();
+		std::vector< bool > start( n );
+		const uint64_t code = grayCode( first );
+		for( size_t v=0; v<n; ++v )
+			start[ v ] = ( code >> v ) & 1;
+
+		IncrementalEvaluator evaluator( instance, start );
+		ChunkResult result;
+		result.best = first;
+		result.bestValue = evaluator.current();
+		if( withDistribution )
+			++result.distribution[ distributionKey( result.bestValue ) ];
+
+		for( uint64_t i=first + 1; i<last; ++i ) {
+			double value = evaluator.flip( countTrailingZeros64( i ) );
+			if( ( i - first ) % RESYNC_INTERVAL == 0 ) {
+				evaluator.resynchronize();
+				value = evaluator.current();
+			}
+
+			if( value > result.bestValue ) {
+				result.best = i;
+				result.bestValue = value;
+			}
+			if( withDistribution )
+				++result.distribution[ distributionKey( value ) ];
+		}
+		return result;
+	}
+
+	///////////////////////////////
+
+public:
+
+	// numThreads of 0 means one per hardware thread.
+	explicit GrayCodeEnumerator( const ProblemInstance& instance_, unsigned numThreads_ = 0 )
+	: instance( instance_ ), numThreads( numThreads_ ) {
+		if( instance.getNumGenes() > static_cast< size_t >( MAX_NUM_GENES ) )
+			throw std::invalid_argument( "Too many variables for GrayCodeEnumerator" );
+
+		if( numThreads == 0 )
+			numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+	}
+
+	///////////////////////////////
+
+	Result run( bool withDistribution = false ) const {
+		const int n = static_cast< int >( instance.getNumGenes() );
+		const uint64_t total = uint64_t( 1 ) << n;
+		const uint64_t numChunks = uint64_t( 1 ) << std::min( n, 10 );
+		const uint64_t chunkSize = total / numChunks;
+
+		std::vector< ChunkResult > chunks( numChunks );
+		std::atomic< uint64_t > nextChunk( 0 );
+		std::vector< std::exception_ptr > errors( numThreads );
+
+		struct Worker {
+			static void run( const GrayCodeEnumerator* self, std::atomic< uint64_t >* nextChunk, uint64_t numChunks,
+				uint64_t chunkSize, bool withDistribution, std::vector< ChunkResult >* chunks, std::exception_ptr* error ) {
+				try {
+					for( uint64_t c = ( *nextChunk )++; c < numChunks; c = ( *nextChunk )++ )
+						( *chunks )[ c ] = self->enumerate( c * chunkSize, ( c + 1 ) * chunkSize, withDistribution );
+				}
+				catch( ... ) {
+					*error = std::current_exception();
+				}
+			}
+		};
+
+		const unsigned numWorkers = static_cast< unsigned >( std::min< uint64_t >( numThreads, numChunks ) );
+		std::vector< std::thread > workers;
+		for( unsigned t=1; t<numWorkers; ++t )
+			workers.push_back( std::thread( &Worker::run, this, &nextChunk, numChunks, chunkSize,
+				withDistribution, &chunks, &errors[ t ] ) );
+		Worker::run( this, &nextChunk, numChunks, chunkSize, withDistribution, &chunks, &errors[ 0 ] );
+		for( size_t t=0; t<workers.size(); ++t )
+			workers[ t ].join();
+
+		for( size_t t=0; t<errors.size(); ++t )
+			if( errors[ t ] )
+				std::rethrow_exception( errors[ t ] );
+
+		///////////////////////////
+
+		Result result;
+		uint64_t best = chunks[ 0 ].best;
+		double bestValue = chunks[ 0 ].bestValue;
+		for( uint64_t c=0; c<numChunks; ++c ) {
+			if( chunks[ c ].bestValue > bestValue ) {
+				best = chunks[ c ].best;
+				bestValue = chunks[ c ].bestValue;
+			}
+			if( withDistribution ) {
+				const std::map< double, uint64_t >& d = chunks[ c ].distribution;
+				for( std::map< double, uint64_t >::const_iterator it = d.begin(); it != d.end(); ++it )
+					result.distribution[ it->first ] += it->second;
+			}
+		}
+
+		const uint64_t code = grayCode( best );
+		result.best.resize( n );
+		for( int v=0; v<n; ++v )
+			result.best[ v ] = ( code >> v ) & 1;
+		result.bestValue = instance.value( result.best );
+		result.numEvaluated = total;
+		return result;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
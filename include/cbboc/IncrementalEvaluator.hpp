@@ -0,0 +1,188 @@
+#ifndef CBBOC_INCREMENTALEVALUATOR_HPP
+#define CBBOC_INCREMENTALEVALUATOR_HPP
+
+#include "ProblemInstance.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Single-bit-flip delta evaluation for a ProblemInstance.
+ *
+ * Keeps an incumbent candidate together with the current table index
+ * and contribution of every subfunction, plus an inverted index from
+ * each variable to the subfunctions that read it. Flipping (or probing
+ * a flip of) variable i then costs O(deg(i)) rather than the O(M*K)
+ * of a full ProblemInstance::value call.
+ *
+ * current() is maintained by accumulating deltas, so after many flips
+ * it may differ from ProblemInstance::value in the last few ulps;
+ * resynchronize() recomputes it from scratch.
+ *
+ * The instance must outlive the evaluator.
+ */
+
+class IncrementalEvaluator {
+
+	const ProblemInstance& instance;
+
+	std::vector< char > candidate;
+
+	// A copy of the instance's variable indices, taken once by
+	// buildInvertedIndex().
+	std::vector< int > varIndices;
+
+	// Inverted index in compressed-row form: the subfunctions reading
+	// variable i are subfns[ varOffsets[ i ] .. varOffsets[ i + 1 ] ),
+	// with the table index bit(s) that variable i drives in masks[].
+	std::vector< int > varOffsets;
+	std::vector< int > subfns;
+	std::vector< int > masks;
+
+	std::vector< int > tableIndices;
+	std::vector< double > contributions;
+	double total;
+
+	///////////////////////////////
+
+	void buildInvertedIndex() {
+		const int K = instance.getK();
+		const int M = instance.getM();
+		varIndices = instance.getVarIndices();
+
+		// Count pass, then fill pass. A variable that occurs more than once
+		// in a subfunction gets a single entry with the masks or-ed together.
+		std::vector< int > lastSubfn( candidate.size(), -1 );
+		varOffsets.assign( candidate.size() + 1, 0 );
+		for( int s=0; s<M; ++s ) {
+			for( int j=0; j<K; ++j ) {
+				const int v = varIndices[ s * K + j ];
+				if( lastSubfn[ v ] != s ) {
+					lastSubfn[ v ] = s;
+					++varOffsets[ v + 1 ];
+				}
+			}
+		}
+
+		for( size_t v=0; v<candidate.size(); ++v )
+			varOffsets[ v + 1 ] += varOffsets[ v ];
+
+		subfns.assign( varOffsets.back(), -1 );
+		masks.assign( varOffsets.back(), 0 );
+
+		std::vector< int > next( varOffsets.begin(), varOffsets.end() - 1 );
+		for( int s=0; s<M; ++s ) {
+			for( int j=0; j<K; ++j ) {
+				const int v = varIndices[ s * K + j ];
+				const int mask = 1 << ( K - 1 - j );
+				if( next[ v ] > varOffsets[ v ] && subfns[ next[ v ] - 1 ] == s )
+					masks[ next[ v ] - 1 ] |= mask;
+				else {
+					subfns[ next[ v ] ] = s;
+					masks[ next[ v ] ] = mask;
+					++next[ v ];
+				}
+			}
+		}
+	}
+
+	void checkIndex( size_t i, const char* where ) const {
+		if( i >= candidate.size() )
+			throw std::invalid_argument( std::string( "Bad variable index in IncrementalEvaluator." ) + where );
+	}
+
+	///////////////////////////////
+
+public:
+
+	IncrementalEvaluator( const ProblemInstance& instance_, const std::vector< bool >& initial )
+	: instance( instance_ ), total( 0.0 ) {
+		if( initial.size() != instance.getNumGenes() )
+			throw std::invalid_argument( "Bad argument to IncrementalEvaluator" );
+
+		candidate.assign( initial.begin(), initial.end() );
+		buildInvertedIndex();
+		resynchronize();
+	}
+
+	///////////////////////////////
+
+	// Recompute every subfunction contribution and the total from the incumbent.
+	void resynchronize() {
+		const int K = instance.getK();
+		const int M = instance.getM();
+		const int* vars = varIndices.data();
+
+		tableIndices.resize( M );
+		contributions.resize( M );
+		total = 0.0;
+		for( int s=0; s<M; ++s, vars += K ) {
+			int fnTableIndex = 0;
+			for( int j=0; j<K; ++j ) {
+				fnTableIndex <<= 1;
+				fnTableIndex |= candidate[ vars[ j ] ] ? 1 : 0;
+			}
+
+			tableIndices[ s ] = fnTableIndex;
+			contributions[ s ] = instance.fnTableEntry( s, fnTableIndex );
+			total += contributions[ s ];
+		}
+	}
+
+	///////////////////////////////
+
+	// Change in value that flipping variable i would cause; the incumbent is unchanged.
+	double deltaIfFlipped( size_t i ) const {
+		checkIndex( i, "deltaIfFlipped" );
+
+		double delta = 0.0;
+		for( int e=varOffsets[ i ]; e<varOffsets[ i + 1 ]; ++e ) {
+			const int s = subfns[ e ];
+			delta += instance.fnTableEntry( s, tableIndices[ s ] ^ masks[ e ] ) - contributions[ s ];
+		}
+
+		return delta;
+	}
+
+	// Flip variable i of the incumbent and return the new value.
+	double flip( size_t i ) {
+		checkIndex( i, "flip" );
+
+		for( int e=varOffsets[ i ]; e<varOffsets[ i + 1 ]; ++e ) {
+			const int s = subfns[ e ];
+			tableIndices[ s ] ^= masks[ e ];
+			const double incoming = instance.fnTableEntry( s, tableIndices[ s ] );
+			total += incoming - contributions[ s ];
+			contributions[ s ] = incoming;
+		}
+
+		candidate[ i ] = !candidate[ i ];
+		return total;
+	}
+
+	double current() const { return total; }
+
+	///////////////////////////////
+
+	bool get( size_t i ) const { checkIndex( i, "get" ); return candidate[ i ] != 0; }
+
+	std::vector< bool > getCandidate() const {
+		return std::vector< bool >( candidate.begin(), candidate.end() );
+	}
+
+	// Number of subfunctions that read variable i.
+	int degree( size_t i ) const {
+		checkIndex( i, "degree" );
+		return varOffsets[ i + 1 ] - varOffsets[ i ];
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,139 @@
+#ifndef CBBOC_INSTANCECOMPILER_HPP
+#define CBBOC_INSTANCECOMPILER_HPP
+
+#include "ProblemInstance.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Ahead-of-time compiler from a ProblemInstance to C++ source.
+ *
+ * The generated file holds the ( interned ) tables as one constexpr
+ * array and an evaluation function with one statement per subfunction,
+ * in which the variable indices, and so the words and shifts they read,
+ * and the table offsets are all constants. Compiled and linked into a
+ * program, it registers itself under the instance's fingerprint, with
+ * the tables and indices it was generated from ( see CompiledInstances.hpp ),
+ * after which any ProblemInstance loaded from the same data, and any ObjectiveFn over it, evaluates through it.
+ * Subfunctions are summed in order, so results are identical to the
+ * scalar path.
+ */
+
+namespace cbboc_compiler {
+
+///////////////////////////////////
+
+// Shortest decimal form that reads back as exactly x.
+inline std::string exactLiteral( double x ) {
+	for( int precision=1; ; ++precision ) {
+		std::ostringstream os;
+		os << std::setprecision( precision ) << x;
+		if( std::strtod( os.str().c_str(), nullptr ) == x || precision >= 17 ) {
+			std::string result = os.str();
+			if( result.find_first_of( ".e" ) == std::string::npos )
+				result += ".0";
+			return result;
+		}
+	}
+}
+
+// name with every character that can't appear in an identifier replaced by '_'.
+inline std::string identifierFrom( const std::string& name ) {
+	std::string result = name.empty() ? "instance" : name;
+	for( size_t i=0; i<result.size(); ++i ) {
+		const char c = result[ i ];
+		const bool ok = ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+		if( !ok )
+			result[ i ] = '_';
+	}
+	if( result[ 0 ] >= '0' && result[ 0 ] <= '9' )
+		result = "instance_" + result;
+	return result;
+}
+
+///////////////////////////////////
+
+// A constexpr array of the count values at begin, with one 0 if there are none.
+template < typename T >
+void writeArray( const std::string& type, const std::string& name, const T* begin, size_t count, std::ostream& os ) {
+	os << "constexpr " << type << " " << name << "[ " << std::max< size_t >( count, 1 ) << " ] = {";
+	for( size_t e=0; e<count; ++e )
+		os << ( e % 8 == 0 ? "\n\t" : " " ) << begin[ e ] << ",";
+	os << ( count == 0 ? " 0 };\n\n" : "\n};\n\n" );
+}
+
+inline void writeCompiledInstance( const ProblemInstance& instance, const std::string& name, std::ostream& os ) {
+	const int K = instance.getK();
+	const int M = instance.getM();
+	const size_t tableSize = size_t( 1 ) << K;
+	const std::vector< int > vars = instance.getVarIndices();
+	const SharedArray< int >& offsets = instance.getTables().getTableOffsets();
+	const std::string id = identifierFrom( name );
+
+	std::vector< double > pool( instance.getTables().numDistinctTables() * tableSize );
+	for( int i=0; i<M; ++i )
+		for( size_t t=0; t<tableSize; ++t )
+			pool[ offsets[ i ] + t ] = instance.fnTableEntry( i, t );
+
+	std::ostringstream fingerprint;
+	fingerprint << "0x" << std::hex << std::setw( 16 ) << std::setfill( '0' ) << instance.fingerprint() << "ULL";
+
+	os << "// Generated by CompileInstance from " << name << ": do not edit.\n";
+	os << "// numGenes=" << instance.getNumGenes() << " K=" << K << " M=" << M << "\n\n";
+	os << "#include \"cbboc/CompiledInstances.hpp\"\n";
+	os << "#include \"cbboc/ValueKernels.hpp\"\n\n";
+	os << "#include <vector>\n\n";
+	os << "//////////////////////////////////////////////////////////////////////\n\n";
+	os << "namespace {\n\nnamespace " << id << " {\n\n";
+
+	std::vector< std::string > literals( pool.size() );
+	for( size_t e=0; e<pool.size(); ++e )
+		literals[ e ] = exactLiteral( pool[ e ] );
+	writeArray( "double", "pool", literals.data(), literals.size(), os );
+	writeArray( "int", "vars", vars.data(), vars.size(), os );
+	writeArray( "int", "tableOffsets", offsets.data(), offsets.size(), os );
+
+	os << "template < typename Candidate >\n";
+	os << "double value( const Candidate& x ) {\n";
+	os << "\tusing cbboc_kernels::bitAt;\n";
+	os << "\tdouble total = 0.0;\n";
+	for( int i=0; i<M; ++i ) {
+		os << "\ttotal += pool[ " << offsets[ i ] << " + ( ";
+		for( int j=0; j<K; ++j ) {
+			os << ( j == 0 ? "" : " | " ) << "bitAt( x, " << vars[ i * K + j ] << " )";
+			if( K - 1 - j > 0 )
+				os << " << " << K - 1 - j;
+		}
+		os << " ) ];\n";
+	}
+	os << "\treturn total;\n}\n\n";
+
+	os << "const CompiledInstance compiled = {\n";
+	os << "\t" << fingerprint.str() << ",\n";
+	os << "\t" << instance.getNumGenes() << ", " << K << ", " << M << ",\n";
+	os << "\tvars, tableOffsets, pool, " << pool.size() << ",\n";
+	os << "\t&value< std::vector< bool > >,\n";
+	os << "\t&value< PackedBitvector >\n};\n\n";
+	os << "const CompiledInstanceRegistration registration( compiled );\n\n";
+	os << "} // namespace " << id << " {\n\n} // namespace {\n\n";
+	os << "// End ///////////////////////////////////////////////////////////////\n";
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_compiler {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,211 @@
+#ifndef CBBOC_INSTANCEGENERATOR_HPP
+#define CBBOC_INSTANCEGENERATOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Synthetic instances in the text format read by ProblemInstance, for
+ * stress and scaling tests well beyond the sizes of the sample classes.
+ *
+ * Subfunction i reads K distinct variables chosen by an adjacency model:
+ * - RANDOM: uniformly at random;
+ * - ADJACENT: the K consecutive variables, modulo n, from i * n / M, so
+ *   that with M = n subfunction i reads i, i+1, .. as in sample4;
+ * - CLUSTERED: the variables are cut into clusters of clusterSize
+ *   consecutive variables and subfunction i has home cluster i modulo
+ *   their number; each of its variables comes from the home cluster, or
+ *   with probability mixing from anywhere.
+ * Table entries have 4 decimals, as in the samples, drawn from:
+ * - UNIFORM: uniformly from [ 0, 1 );
+ * - LEVELS: uniformly from numLevels values evenly spaced over [ 0, 1 ];
+ * - TRAP: deceptive traps, 1 with all K bits set and otherwise
+ *   ( K - 1 - ones ) / K, rounded, the same table for every subfunction.
+ *
+ * Each instance is generated from its own engine, seeded with the seed,
+ * the stream ( training or testing ) and its index in the stream, so it
+ * is the same whatever else is generated, and classes can be
+ * regenerated, or extended, exactly. The engine's output is fixed by
+ * the standard, and numbers are drawn from it directly rather than
+ * through the std:: distributions, whose results vary between standard
+ * libraries, so the same seed gives the same instances everywhere.
+ */
+
+namespace cbboc_generator {
+
+///////////////////////////////////
+
+enum AdjacencyModel { RANDOM, ADJACENT, CLUSTERED };
+enum ValueDistribution { UNIFORM, LEVELS, TRAP };
+enum Stream { TRAINING_STREAM, TESTING_STREAM };
+
+struct GeneratorSettings {
+	size_t numGenes;
+	int M;
+	int K;
+	AdjacencyModel adjacency;
+	int clusterSize;
+	double mixing;
+	ValueDistribution values;
+	int numLevels;
+	long maxEvals;
+	uint64_t seed;
+
+	GeneratorSettings()
+	: numGenes( 0 ), M( 0 ), K( 0 ), adjacency( RANDOM ), clusterSize( 32 ), mixing( 0.1 ),
+	  values( UNIFORM ), numLevels( 4 ), maxEvals( 0 ), seed( 0 ) {}
+
+	void check() const {
+		if( numGenes == 0 || numGenes > 0x7FFFFFFF || M < 0 || K <= 0 || K >= 31 || static_cast< size_t >( K ) > numGenes ||
+			maxEvals <= 0 || maxEvals > 0x7FFFFFFF || numLevels < 2 || !( mixing >= 0.0 && mixing <= 1.0 ) ||
+			( adjacency == CLUSTERED && ( clusterSize < K || static_cast< size_t >( clusterSize ) > numGenes ) ) )
+			throw std::invalid_argument( "Bad GeneratorSettings" );
+	}
+};
+
+///////////////////////////////////
+
+namespace detail {
+
+// Table entries are generated in units of 10^-4.
+const int TICKS = 10000;
+
+inline void writePadded( std::string& out, uint64_t x, int width ) {
+	char digits[ 24 ];
+	int n = 0;
+	do {
+		digits[ n++ ] = static_cast< char >( '0' + x % 10 );
+		x /= 10;
+	} while( x != 0 );
+	for( int i=n; i<width; ++i )
+		out += '0';
+	while( n > 0 )
+		out += digits[ --n ];
+}
+
+inline void writeTicks( std::string& out, int ticks ) {
+	writePadded( out, ticks / TICKS, 1 );
+	out += '.';
+	writePadded( out, ticks % TICKS, 4 );
+}
+
+inline int numDigits( uint64_t x ) {
+	int result = 1;
+	for( ; x >= 10; x /= 10 )
+		++result;
+	return result;
+}
+
+// Uniform on [ 0, n ), by rejection from the top of the engine's range.
+inline uint64_t uniformBelow( uint64_t n, std::mt19937_64& rng ) {
+	const uint64_t limit = ~uint64_t( 0 ) - ~uint64_t( 0 ) % n;
+	uint64_t x;
+	do {
+		x = rng();
+	} while( x >= limit );
+	return x % n;
+}
+
+// True with probability p, to 53 bits.
+inline bool withProbability( double p, std::mt19937_64& rng ) {
+	return static_cast< double >( rng() >> 11 ) * ( 1.0 / 9007199254740992.0 ) < p;
+}
+
+inline void chooseVariables( const GeneratorSettings& s, int i, std::mt19937_64& rng, std::vector< int >& vars ) {
+	const int n = static_cast< int >( s.numGenes );
+	vars.clear();
+	if( s.adjacency == ADJACENT ) {
+		const int first = static_cast< int >( static_cast< uint64_t >( i ) * s.numGenes / std::max( s.M, 1 ) );
+		for( int j=0; j<s.K; ++j )
+			vars.push_back( ( first + j ) % n );
+		return;
+	}
+
+	const int numClusters = s.adjacency == CLUSTERED ? std::max( 1, n / s.clusterSize ) : 1;
+	const int home = ( i % numClusters ) * s.clusterSize;
+	while( static_cast< int >( vars.size() ) < s.K ) {
+		const int v = static_cast< int >( s.adjacency == CLUSTERED && !withProbability( s.mixing, rng ) ?
+			home + uniformBelow( s.clusterSize, rng ) : uniformBelow( n, rng ) );
+		if( std::find( vars.begin(), vars.end(), v ) == vars.end() )
+			vars.push_back( v );
+	}
+}
+
+inline int entryTicks( const GeneratorSettings& s, int t, std::mt19937_64& rng ) {
+	switch( s.values ) {
+		case UNIFORM : return static_cast< int >( uniformBelow( TICKS, rng ) );
+		case LEVELS : {
+			const int level = static_cast< int >( uniformBelow( s.numLevels, rng ) );
+			return static_cast< int >( ( static_cast< int64_t >( level ) * TICKS * 2 + ( s.numLevels - 1 ) ) / ( 2 * ( s.numLevels - 1 ) ) );
+		}
+		case TRAP : {
+			int ones = 0;
+			for( int j=0; j<s.K; ++j )
+				ones += ( t >> j ) & 1;
+			return ones == s.K ? TICKS : ( ( s.K - 1 - ones ) * TICKS * 2 + s.K ) / ( 2 * s.K );
+		}
+	}
+	throw std::logic_error( "Bad ValueDistribution" );
+}
+
+} // namespace detail {
+
+///////////////////////////////////
+
+// Writes instance number index of the given stream of the class that
+// settings describe.
+inline void writeGeneratedInstance( const GeneratorSettings& settings, Stream stream, uint64_t index, std::ostream& os ) {
+	using namespace detail;
+	settings.check();
+
+	std::seed_seq seeds = { static_cast< uint32_t >( settings.seed ), static_cast< uint32_t >( settings.seed >> 32 ),
+		static_cast< uint32_t >( stream ), static_cast< uint32_t >( index ), static_cast< uint32_t >( index >> 32 ) };
+	std::mt19937_64 rng( seeds );
+
+	std::string line;
+	writePadded( line, settings.numGenes, 3 );
+	line += ' ';
+	writePadded( line, settings.maxEvals, 6 );
+	line += ' ';
+	writePadded( line, settings.K, 1 );
+	line += ' ';
+	writePadded( line, settings.M, 1 );
+	os << line << '\n';
+
+	const int width = std::max( 3, numDigits( settings.numGenes - 1 ) );
+	const int tableSize = 1 << settings.K;
+	std::vector< int > vars;
+	for( int i=0; i<settings.M; ++i ) {
+		chooseVariables( settings, i, rng, vars );
+		line.clear();
+		for( int j=0; j<settings.K; ++j ) {
+			writePadded( line, vars[ j ], width );
+			line += ' ';
+		}
+		for( int t=0; t<tableSize; ++t ) {
+			writeTicks( line, entryTicks( settings, t, rng ) );
+			line += t + 1 < tableSize ? ' ' : '\n';
+		}
+		os << line;
+	}
+
+	if( !os )
+		throw std::runtime_error( "error writing generated instance" );
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_generator {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,256 @@
+#ifndef CBBOC_INSTANCEPARSER_HPP
+#define CBBOC_INSTANCEPARSER_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Parser for the text format of problem instances: a header line
+ * "numGenes maxEvalsPerInstance K M", then M rows of K variable indices
+ * and 2^K table entries, separated by any whitespace.
+ *
+ * The whole file is read into one buffer and tokenized in place, with no
+ * locale and no allocation per token, straight into flat storage sized
+ * from the header. Table entries with at most 19 significant digits and
+ * no exponent ( which covers the 4-decimal entries of the samples ) are
+ * converted by one exact integer division, correctly rounded, and any
+ * other number by strtod, so values are bit for bit those that stream
+ * extraction gives. With reference set, every entry goes through strtod,
+ * to check that claim ( see tools/ConvertInstances.cpp ). Errors throw
+ * std::runtime_error naming the source, line and column:
+ * "source:line:column: message".
+ */
+
+namespace cbboc_parser {
+
+///////////////////////////////////
+
+// The contents of one instance file, in the flat layout of
+// ProblemInstance: K variable indices and 2^K table entries per
+// subfunction, in subfunction order.
+struct InstanceData {
+	size_t numGenes;
+	int maxEvalsPerInstance;
+	int K;
+	int M;
+	std::vector< int > varIndices;
+	std::vector< double > fnTables;
+
+	InstanceData() : numGenes( 0 ), maxEvalsPerInstance( 0 ), K( 0 ), M( 0 ) {}
+};
+
+///////////////////////////////////
+
+class Tokenizer {
+
+	const char* p;
+	const char* const end;
+	const char* lineStart;
+	int line;
+	const std::string& source;
+	const bool reference;
+
+	static bool isSpace( char c ) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; }
+	static bool isDigit( char c ) { return c >= '0' && c <= '9'; }
+
+	// Powers of ten that are exact in a double.
+	static double exactPowerOf10( int e ) {
+		static const double powers[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		return powers[ e ];
+	}
+
+	const char* tokenEnd() const {
+		const char* q = p;
+		while( q != end && !isSpace( *q ) )
+			++q;
+		return q;
+	}
+
+	double slowNumber( const char* tokenBegin, const char* tokenEnd_ ) const {
+		const std::string token( tokenBegin, tokenEnd_ );
+		char* parsedEnd = nullptr;
+		const double result = std::strtod( token.c_str(), &parsedEnd );
+		if( token.empty() || parsedEnd != token.c_str() + token.size() )
+			fail( "expected a number, found \"" + token + "\"" );
+		return result;
+	}
+
+public:
+
+	Tokenizer( const char* begin, const char* end_, const std::string& source_, bool reference_ = false )
+	: p( begin ), end( end_ ), lineStart( begin ), line( 1 ), source( source_ ), reference( reference_ ) {}
+
+	// Skip whitespace; returns false at the end of the input.
+	bool skipSpace() {
+		for( ; p != end && isSpace( *p ); ++p )
+			if( *p == '\n' ) {
+				++line;
+				lineStart = p + 1;
+			}
+		return p != end;
+	}
+
+	void fail( const std::string& message ) const {
+		std::ostringstream os;
+		os << source << ':' << line << ':' << ( p - lineStart + 1 ) << ": " << message;
+		throw std::runtime_error( os.str() );
+	}
+
+	// A decimal integer in [ minValue, maxValue ], as a whole token.
+	uint64_t unsignedInteger( uint64_t minValue, uint64_t maxValue, const char* what ) {
+		if( !skipSpace() )
+			fail( std::string( "unexpected end of file, expected " ) + what );
+
+		const char* q = p;
+		if( *q == '+' )
+			++q;
+		if( q == end || !isDigit( *q ) )
+			fail( std::string( "expected " ) + what + ", found \"" + std::string( p, tokenEnd() ) + "\"" );
+
+		uint64_t result = 0;
+		for( ; q != end && isDigit( *q ); ++q ) {
+			result = result * 10 + static_cast< uint64_t >( *q - '0' );
+			if( result > maxValue )
+				fail( std::string( what ) + " out of range" );
+		}
+		if( q != end && !isSpace( *q ) )
+			fail( std::string( "expected " ) + what + ", found \"" + std::string( p, tokenEnd() ) + "\"" );
+		if( result < minValue )
+			fail( std::string( what ) + " out of range" );
+
+		p = q;
+		return result;
+	}
+
+	double number() {
+		if( !skipSpace() )
+			fail( "unexpected end of file, expected a table entry" );
+
+		const char* q = p;
+		const bool negative = *q == '-';
+		if( *q == '-' || *q == '+' )
+			++q;
+
+		uint64_t mantissa = 0;
+		int digits = 0, decimals = 0;
+		bool anyDigit = false, point = false, fast = true;
+		for( ; q != end && !isSpace( *q ); ++q ) {
+			if( isDigit( *q ) ) {
+				anyDigit = true;
+				if( mantissa == 0 && *q == '0' && !point )
+					continue; // ^ leading zeros are not significant.
+				mantissa = mantissa * 10 + static_cast< uint64_t >( *q - '0' );
+				if( point )
+					++decimals;
+				if( ++digits > 19 || decimals > 22 )
+					fast = false;
+			}
+			else if( *q == '.' && !point )
+				point = true;
+			else
+				fast = false;
+		}
+
+		double result = 0.0;
+		if( !reference && fast && anyDigit && mantissa <= ( uint64_t( 1 ) << 53 ) ) {
+			result = static_cast< double >( mantissa ) / exactPowerOf10( decimals );
+			if( negative )
+				result = -result;
+		}
+		else
+			result = slowNumber( p, q );
+
+		p = q;
+		return result;
+	}
+
+	void expectEnd() {
+		if( skipSpace() )
+			fail( "unexpected content after the last subfunction" );
+	}
+
+	size_t remaining() const { return static_cast< size_t >( end - p ); }
+};
+
+///////////////////////////////////
+
+inline void parseInstance( const char* begin, const char* end, const std::string& source, InstanceData& result,
+	bool reference = false ) {
+	Tokenizer tokens( begin, end, source, reference );
+
+	result.numGenes = static_cast< size_t >( tokens.unsignedInteger( 1, 0x7FFFFFFF, "the number of variables" ) );
+	result.maxEvalsPerInstance = static_cast< int >( tokens.unsignedInteger( 0, 0x7FFFFFFF, "the number of evaluations" ) );
+	result.K = static_cast< int >( tokens.unsignedInteger( 1, 30, "K" ) );
+	result.M = static_cast< int >( tokens.unsignedInteger( 0, 0x7FFFFFFF, "M" ) );
+
+	// Every token takes at least two characters, which rejects a header
+	// claiming more rows than the file could hold before allocating them.
+	const size_t K = static_cast< size_t >( result.K ), tableSize = size_t( 1 ) << K;
+	if( static_cast< size_t >( result.M ) * ( K + tableSize ) > tokens.remaining() / 2 + 1 )
+		tokens.fail( "file too short for the number of subfunctions in the header" );
+
+	result.varIndices.resize( static_cast< size_t >( result.M ) * K );
+	result.fnTables.resize( static_cast< size_t >( result.M ) * tableSize );
+	int* vars = result.varIndices.data();
+	double* entries = result.fnTables.data();
+	for( int i=0; i<result.M; ++i ) {
+		for( size_t j=0; j<K; ++j )
+			*vars++ = static_cast< int >( tokens.unsignedInteger( 0, result.numGenes - 1, "a variable index" ) );
+		for( size_t t=0; t<tableSize; ++t )
+			*entries++ = tokens.number();
+	}
+
+	tokens.expectEnd();
+}
+
+///////////////////////////////////
+
+// Appends what remains of is to buffer.
+inline void readAll( std::basic_istream< char >& is, std::vector< char >& buffer ) {
+	const size_t CHUNK = 1 << 16;
+	for( ;; ) {
+		const size_t size = buffer.size();
+		buffer.resize( size + CHUNK );
+		is.read( buffer.data() + size, CHUNK );
+		buffer.resize( size + static_cast< size_t >( is.gcount() ) );
+		if( !is )
+			break;
+	}
+	if( is.bad() )
+		throw std::runtime_error( "error reading instance" );
+}
+
+inline void readFile( const std::string& path, std::vector< char >& buffer ) {
+	std::ifstream ifs( path.c_str(), std::ios::binary );
+	if( !ifs )
+		throw std::runtime_error( "cannot open " + path );
+
+	buffer.clear();
+	ifs.seekg( 0, std::ios::end );
+	const std::streamoff length = ifs.tellg();
+	ifs.seekg( 0, std::ios::beg );
+	if( length > 0 )
+		buffer.reserve( static_cast< size_t >( length ) );
+	readAll( ifs, buffer );
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_parser {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,292 @@
+#ifndef CBBOC_INTERNEDTABLES_HPP
+#define CBBOC_INTERNEDTABLES_HPP
+
+#include "SharedArray.hpp"
+#include "ValueKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * The lookup tables of an instance, interned at load.
+ *
+ * Subfunctions whose tables are identical share one entry of a pool of
+ * distinct tables (2^K entries each, in order of first use), and each
+ * subfunction keeps only the offset of its table in the pool. If all
+ * tables together use at most MAX_PALETTE_SIZE distinct values, the
+ * pool holds one byte per entry, an index into a value palette, rather
+ * than a double; sample1 and sample3 shrink this way by about a factor
+ * of eight. Values are compared by bit pattern, so entries read back
+ * exactly as they were loaded.
+ *
+ * toFixedPoint() further replaces the values by 32-bit integer multiples 
+ * of 10^-d, for the fewest decimals d ( at most MAX_DECIMALS ) with which
+ * every value reads back exactly, so that sums of entries can be formed
+ * exactly in integer arithmetic.
+ *
+ * The arrays are immutable and shared between copies, and can also
+ * refer to memory owned elsewhere, such as a mapped binary instance
+ * file ( see BinaryInstance.hpp ).
+ */
+
+class InternedTables {
+
+	int K;
+
+	// Pool offset of each subfunction's table.
+	SharedArray< int > tableOffsets;
+
+	// Exactly one of these holds the pool: codes when coded, otherwise 
+	// doubles, or fixed-point values once converted to fixed point.
+	// The codes are followed by CODE_PADDING zero bytes, so that a 32-bit
+	// gather can read any code.
+	SharedArray< double > pool;
+	SharedArray< int32_t > fixedPool;
+	SharedArray< unsigned char > codes;
+
+	// Distinct values, ordered by bit pattern, and once converted to 
+	// fixed point, the same values times scale.
+	SharedArray< double > palette;
+	SharedArray< int32_t > fixedPalette;
+
+	// 10^decimals, or 0 if not in fixed point.
+	double scale;
+
+	///////////////////////////////
+
+	static uint64_t bitsOf( double x ) {
+		uint64_t result;
+		std::memcpy( &result, &x, sizeof( result ) );
+		return result;
+	}
+
+	struct TableLess {
+		const std::vector< double >& tables;
+		size_t tableSize;
+		TableLess( const std::vector< double >& t, size_t s ) : tables( t ), tableSize( s ) {}
+		bool operator ()( int a, int b ) const {
+			for( size_t t=0; t<tableSize; ++t ) {
+				const uint64_t x = bitsOf( tables[ a * tableSize + t ] );
+				const uint64_t y = bitsOf( tables[ b * tableSize + t ] );
+				if( x != y )
+					return x < y;
+			}
+			return false;
+		}
+	};
+
+	static bool bitsLess( double a, double b ) { return bitsOf( a ) < bitsOf( b ); }
+	static bool bitsEqual( double a, double b ) { return bitsOf( a ) == bitsOf( b ); }
+
+	// True, setting q, if x is q / scale exactly with q in 32 bits.
+	static bool fixedPointOf( double x, double scale, int32_t& q ) {
+		const double scaled = std::floor( x * scale + 0.5 );
+		if( !( scaled >= -2147483647.0 && scaled <= 2147483647.0 ) )
+			return false;
+
+		q = static_cast< int32_t >( scaled );
+		return bitsEqual( q / scale, x );
+	}
+
+	size_t numEntries() const {
+		if( isCoded() )
+			return codes.size() - CODE_PADDING;
+		return isFixedPoint() ? fixedPool.size() : pool.size();
+	}
+
+	///////////////////////////////
+
+public:
+
+	static const size_t MAX_PALETTE_SIZE = 256;
+	static const size_t CODE_PADDING = 3;
+	static const int MAX_DECIMALS = 9;
+
+	InternedTables() : K( 0 ), scale( 0.0 ) {}
+
+	// tables holds M = tables.size() / 2^K tables of 2^K entries each.
+	InternedTables( int K_, const std::vector< double >& tables ) : K( K_ ), scale( 0.0 ) {
+		const size_t tableSize = size_t( 1 ) << K;
+		if( tables.size() % tableSize != 0 )
+			throw std::invalid_argument( "Bad argument to InternedTables" );
+
+		const int M = static_cast< int >( tables.size() / tableSize );
+
+		// Equal tables end up adjacent, each group led by its first use.
+		std::vector< int > order( M );
+		for( int i=0; i<M; ++i )
+			order[ i ] = i;
+		std::stable_sort( order.begin(), order.end(), TableLess( tables, tableSize ) );
+
+		std::vector< int > firstUse( M );
+		for( int r=0; r<M; ++r ) {
+			const bool startsGroup = r == 0 || TableLess( tables, tableSize )( order[ r - 1 ], order[ r ] );
+			firstUse[ order[ r ] ] = startsGroup ? order[ r ] : firstUse[ order[ r - 1 ] ];
+		}
+
+		std::vector< int > distinct;
+		std::vector< int > offsets( M );
+		for( int i=0; i<M; ++i ) {
+			if( firstUse[ i ] == i ) {
+				offsets[ i ] = static_cast< int >( distinct.size() * tableSize );
+				distinct.push_back( i );
+			}
+			else
+				offsets[ i ] = offsets[ firstUse[ i ] ];
+		}
+		tableOffsets = SharedArray< int >( std::move( offsets ) );
+
+		std::vector< double > values( tables );
+		std::sort( values.begin(), values.end(), bitsLess );
+		values.erase( std::unique( values.begin(), values.end(), bitsEqual ), values.end() );
+
+		if( values.size() <= MAX_PALETTE_SIZE ) {
+			if( values.empty() )
+				values.push_back( 0.0 ); // ^ with no tables, so that the padding codes are in range.
+
+			std::vector< unsigned char > coded;
+			coded.reserve( distinct.size() * tableSize + CODE_PADDING );
+			for( size_t d=0; d<distinct.size(); ++d )
+				for( size_t t=0; t<tableSize; ++t )
+					coded.push_back( static_cast< unsigned char >( std::lower_bound( values.begin(), values.end(),
+						tables[ distinct[ d ] * tableSize + t ], bitsLess ) - values.begin() ) );
+			coded.resize( coded.size() + CODE_PADDING, 0 );
+			codes = SharedArray< unsigned char >( std::move( coded ) );
+		}
+		else {
+			std::vector< double > distinctTables;
+			distinctTables.reserve( distinct.size() * tableSize );
+			for( size_t d=0; d<distinct.size(); ++d )
+				distinctTables.insert( distinctTables.end(), tables.begin() + distinct[ d ] * tableSize,
+					tables.begin() + ( distinct[ d ] + 1 ) * tableSize );
+			pool = SharedArray< double >( std::move( distinctTables ) );
+		}
+		palette = SharedArray< double >( std::move( values ) );
+	}
+
+	// Tables already interned, in arrays held elsewhere: pool is empty
+	// if and only if codes is not, and codes carry their CODE_PADDING.
+	InternedTables( int K_, const SharedArray< int >& tableOffsets_, const SharedArray< double >& palette_,
+		const SharedArray< double >& pool_, const SharedArray< unsigned char >& codes_ )
+	: K( K_ ), tableOffsets( tableOffsets_ ), pool( pool_ ), codes( codes_ ), palette( palette_ ), scale( 0.0 ) {
+		if( pool.empty() == codes.empty() || ( isCoded() && codes.size() < CODE_PADDING ) || !invariant() )
+			throw std::invalid_argument( "Bad argument to InternedTables" );
+	}
+
+	///////////////////////////////
+
+	int getM() const { return static_cast< int >( tableOffsets.size() ); }
+
+	bool isCoded() const { return !codes.empty(); }
+	bool isFixedPoint() const { return scale != 0.0; }
+
+	cbboc_kernels::EntryStorage storage() const {
+		using namespace cbboc_kernels;
+		if( isFixedPoint() )
+			return isCoded() ? CODED_FIXED_POOL : FIXED_POOL;
+		return isCoded() ? CODED_POOL : DOUBLE_POOL;
+	}
+
+	size_t numDistinctTables() const { return K > 0 ? numEntries() >> K : 0; }
+
+	const SharedArray< double >& getPalette() const { return palette; }
+	const SharedArray< int >& getTableOffsets() const { return tableOffsets; }
+
+	// The factor fixed-point values are multiplied by, or 0 if not in fixed point.
+	double getScale() const { return scale; }
+
+	// Entry index of subfunction i's table.
+	double entry( int i, size_t index ) const {
+		const size_t e = tableOffsets[ i ] + index;
+		if( isFixedPoint() )
+			return ( isCoded() ? fixedPalette[ codes[ e ] ] : fixedPool[ e ] ) / scale;
+		return isCoded() ? palette[ codes[ e ] ] : pool[ e ];
+	}
+
+	// Fills in the table fields of an InstanceView.
+	void fillView( cbboc_kernels::InstanceView& result ) const {
+		result.storage = storage();
+		result.offsets = tableOffsets.data();
+		result.pool = pool.data();
+		result.codes = codes.data();
+		result.palette = palette.data();
+		result.fixedPool = fixedPool.data();
+		result.fixedPalette = fixedPalette.data();
+		result.scale = scale;
+	}
+
+	///////////////////////////////
+
+	// Converts to fixed point if every value has at most MAX_DECIMALS 
+	// decimals and any sum of M entries is exact as a double; returns 
+	// whether it did.
+	bool toFixedPoint() {
+		if( isFixedPoint() )
+			return true;
+
+		const int MAX_EXACT_M = 1 << 22; // ^ 2^22 * 2^31 = 2^53
+		if( getM() > MAX_EXACT_M )
+			return false;
+
+		double candidateScale = 1.0;
+		std::vector< int32_t > values( palette.size() );
+		for( int d=0; d<=MAX_DECIMALS; ++d, candidateScale *= 10.0 ) {
+			size_t v = 0;
+			while( v<palette.size() && fixedPointOf( palette[ v ], candidateScale, values[ v ] ) )
+				++v;
+			if( v < palette.size() )
+				continue;
+
+			scale = candidateScale;
+			fixedPalette = SharedArray< int32_t >( values );
+			if( !isCoded() ) {
+				std::vector< int32_t > fixed( pool.size() );
+				for( size_t e=0; e<pool.size(); ++e )
+					fixedPointOf( pool[ e ], scale, fixed[ e ] );
+				fixedPool = SharedArray< int32_t >( std::move( fixed ) );
+				pool = SharedArray< double >();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// The tables laid out one per subfunction, as in the instance file.
+	std::vector< double > expand() const {
+		const size_t tableSize = size_t( 1 ) << K;
+		std::vector< double > result;
+		result.reserve( tableOffsets.size() * tableSize );
+		for( int i=0; i<getM(); ++i )
+			for( size_t t=0; t<tableSize; ++t )
+				result.push_back( entry( i, t ) );
+		return result;
+	}
+
+	///////////////////////////////
+
+	bool invariant() const {
+		const size_t tableSize = size_t( 1 ) << K;
+		const size_t entries = numEntries();
+		if( K <= 0 || entries % tableSize != 0 || ( isCoded() && palette.size() > MAX_PALETTE_SIZE ) )
+			return false;
+
+		for( size_t i=0; i<tableOffsets.size(); ++i )
+			if( tableOffsets[ i ] < 0 || tableOffsets[ i ] % tableSize != 0 || tableOffsets[ i ] + tableSize > entries )
+				return false;
+
+		return true;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,99 @@
+#ifndef CBBOC_MAPPEDFILE_HPP
+#define CBBOC_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * A whole file, mapped read-only into memory for as long as the object
+ * lives. The mapping is shared, so processes mapping the same file share
+ * its pages in the page cache. Where mmap is not available ( _WIN32 ),
+ * the file is read into memory instead.
+ */
+
+class MappedFile {
+
+	const char* bytes;
+	size_t length;
+	std::vector< char > copy;
+
+	void readWhole( const std::string& path ) {
+		std::ifstream ifs( path.c_str(), std::ios::binary );
+		if( !ifs )
+			throw std::runtime_error( "cannot open " + path );
+
+		copy.assign( std::istreambuf_iterator< char >( ifs ), std::istreambuf_iterator< char >() );
+		if( ifs.bad() )
+			throw std::runtime_error( "error reading " + path );
+		bytes = copy.data();
+		length = copy.size();
+	}
+
+public:
+
+	explicit MappedFile( const std::string& path ) : bytes( nullptr ), length( 0 ) {
+#ifdef _WIN32
+		readWhole( path );
+#else
+		const int fd = ::open( path.c_str(), O_RDONLY );
+		if( fd < 0 )
+			throw std::runtime_error( "cannot open " + path );
+
+		struct stat info;
+		if( ::fstat( fd, &info ) != 0 ) {
+			::close( fd );
+			throw std::runtime_error( "cannot stat " + path );
+		}
+
+		length = static_cast< size_t >( info.st_size );
+		if( length > 0 ) {
+			void* mapped = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, fd, 0 );
+			if( mapped == MAP_FAILED ) {
+				::close( fd );
+				length = 0;
+				readWhole( path ); // ^ e.g. a file system without mmap.
+				return;
+			}
+			bytes = static_cast< const char* >( mapped );
+		}
+		::close( fd );
+#endif
+	}
+
+	~MappedFile() {
+#ifndef _WIN32
+		if( copy.empty() && bytes != nullptr )
+			::munmap( const_cast< char* >( bytes ), length );
+#endif
+	}
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator =( const MappedFile& ) = delete;
+
+	///////////////////////////////
+
+	const char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+	// Whether the contents are mapped rather than copied.
+	bool isMapped() const { return bytes != nullptr && copy.empty(); }
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,159 @@
+#ifndef CBBOC_MINIBUCKETBOUND_HPP
+#define CBBOC_MINIBUCKETBOUND_HPP
+
+#include "BucketElimination.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <utility>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Upper bound on the optimum of an instance by mini-bucket elimination,
+ * the relaxation of the variable elimination in ExactSolver.hpp, with
+ * which it shares its steps ( see BucketElimination.hpp ).
+ *
+ * Variables are eliminated in min-degree order ( fewest neighbours left
+ * in the interaction graph, ties to the lowest index ). Each subfunction
+ * goes to the bucket of its first variable to be eliminated; within a
+ * bucket, factors are taken largest first and each joins the first part
+ * whose variables, with its own, number at most iBound + 1. Each part
+ * is maximized over the bucket's variable separately, so the sum of the
+ * results bounds the optimum from above, at a cost exponential in iBound
+ * only, and equals it, up to rounding, if iBound is at least the width.
+ *
+ * Orders wider than maxWidth are costly to find on dense graphs, so for
+ * those this gives up early and returns fallback instead.
+ */
+
+namespace cbboc_bounds {
+
+///////////////////////////////////
+
+namespace detail {
+
+using cbboc_elimination::Factor;
+
+struct ByDecreasingScope {
+	bool operator ()( const Factor& a, const Factor& b ) const { return a.scope.size() > b.scope.size(); }
+};
+
+// Min-degree elimination order, or false if it is wider than maxWidth.
+inline bool minDegreeOrder( size_t numGenes, int K, const std::vector< int >& varIndices, size_t maxWidth,
+	std::vector< int >& order ) {
+	const size_t M = varIndices.size() / K;
+	std::vector< std::set< int > > adjacent( numGenes );
+	for( size_t i=0; i<M; ++i )
+		for( int a=0; a<K; ++a )
+			for( int b=0; b<K; ++b )
+				if( varIndices[ i * K + a ] != varIndices[ i * K + b ] )
+					adjacent[ varIndices[ i * K + a ] ].insert( varIndices[ i * K + b ] );
+
+	typedef std::pair< size_t, int > Score;
+	std::set< Score > queue;
+	for( size_t v=0; v<numGenes; ++v )
+		queue.insert( Score( adjacent[ v ].size(), static_cast< int >( v ) ) );
+
+	order.clear();
+	order.reserve( numGenes );
+	while( !queue.empty() ) {
+		const int v = queue.begin()->second;
+		queue.erase( queue.begin() );
+
+		const std::vector< int > n( adjacent[ v ].begin(), adjacent[ v ].end() );
+		if( n.size() > maxWidth )
+			return false;
+		order.push_back( v );
+
+		for( size_t a=0; a<n.size(); ++a ) {
+			queue.erase( Score( adjacent[ n[ a ] ].size(), n[ a ] ) );
+			adjacent[ n[ a ] ].erase( v );
+			for( size_t b=0; b<n.size(); ++b )
+				if( a != b )
+					adjacent[ n[ a ] ].insert( n[ b ] );
+			queue.insert( Score( adjacent[ n[ a ] ].size(), n[ a ] ) );
+		}
+		std::set< int >().swap( adjacent[ v ] );
+	}
+	return true;
+}
+
+} // namespace detail {
+
+///////////////////////////////////
+
+// The bound for the M = varIndices.size() / K subfunctions over numGenes
+// variables, subfunction i reading variables varIndices[ i * K + j ],
+// most significant first, through the table of 2^K entries at
+// fnTables[ i << K ].
+inline double miniBucketBound( size_t numGenes, int K, const std::vector< int >& varIndices,
+	const std::vector< double >& fnTables, int iBound, size_t maxWidth, double fallback ) {
+	using namespace cbboc_elimination;
+	using namespace detail;
+	std::vector< int > order;
+	if( K <= 0 || iBound < 1 || !minDegreeOrder( numGenes, K, varIndices, maxWidth, order ) )
+		return fallback;
+
+	std::vector< int > position( numGenes );
+	for( size_t step=0; step<order.size(); ++step )
+		position[ order[ step ] ] = static_cast< int >( step );
+
+	const size_t M = varIndices.size() / K;
+	const size_t tableSize = size_t( 1 ) << K;
+	std::vector< std::vector< Factor > > buckets( numGenes );
+	for( size_t i=0; i<M; ++i ) {
+		Factor f = subfunctionFactor( varIndices.data() + i * K, K, fnTables.data() + i * tableSize );
+		moveTo( buckets[ bucketOf( f, position ) ], f );
+	}
+
+	double result = 0.0;
+	for( size_t step=0; step<order.size(); ++step ) {
+		std::vector< Factor >& bucket = buckets[ step ];
+		std::stable_sort( bucket.begin(), bucket.end(), ByDecreasingScope() );
+
+		std::vector< std::vector< Factor > > parts;
+		std::vector< std::vector< int > > partScopes;
+		for( size_t f=0; f<bucket.size(); ++f ) {
+			std::vector< int > merged;
+			size_t p = 0;
+			for( ; p<parts.size(); ++p ) {
+				merged.clear();
+				std::set_union( partScopes[ p ].begin(), partScopes[ p ].end(),
+					bucket[ f ].scope.begin(), bucket[ f ].scope.end(), std::back_inserter( merged ) );
+				if( merged.size() <= static_cast< size_t >( iBound ) + 1 )
+					break;
+			}
+			if( p == parts.size() ) {
+				parts.push_back( std::vector< Factor >() );
+				partScopes.push_back( std::vector< int >() );
+				merged = bucket[ f ].scope;
+			}
+			partScopes[ p ].swap( merged );
+			moveTo( parts[ p ], bucket[ f ] );
+		}
+		std::vector< Factor >().swap( bucket );
+
+		for( size_t p=0; p<parts.size(); ++p ) {
+			Factor message = eliminate( parts[ p ], order[ step ] );
+			if( message.scope.empty() )
+				result += message.table[ 0 ];
+			else
+				moveTo( buckets[ bucketOf( message, position ) ], message );
+		}
+	}
+	return result;
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_bounds {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
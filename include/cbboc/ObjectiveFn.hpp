@@ -3,6 +3,7 @@
 
 #include "ProblemInstance.hpp"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <vector>
@@ -32,6 +33,21 @@ private:
 	std::unique_ptr< std::pair< long, double > > remainingEvaluationsAtBestValue;
 	
 	///////////////////////////////
+
+	// Number of batch candidates evaluated between two reads of the clock.
+	static const size_t BATCH_CHUNK_SIZE = 256;
+
+	bool deadlinePassed() const;
+	void recordValue( long remainingEvaluationsNow, double value );
+
+	template < typename Candidate >
+	double evaluate( const Candidate& candidate );
+
+	template < typename Candidate >
+	std::vector< double > evaluateBatch( const std::vector< Candidate >& batch );
+	// Implementations in CBBOC.hpp, alongside value().
+	
+	///////////////////////////////
 	
 public:
 
@@ -41,8 +57,24 @@ public:
 	///////////////////////////////
 	
 	double value( const std::vector< bool >& candidate );
+	double value( const PackedBitvector& candidate );
 	// Implementation moved to CBBOC2015.hpp to allow `header file only' compilation.
 
+	/**
+	 * Evaluate a batch of candidates back-to-back, as if by calling value()
+	 * on each in turn. The budget is checked once for the whole batch and
+	 * charged chunk by chunk, and the clock is only read between chunks.
+	 *
+	 * Returns the values of the candidates actually evaluated, in order: 
+	 * fewer than batch.size() if the evaluation budget or the deadline ran
+	 * out part way through. As with value(), an exception is thrown if not
+	 * even the first candidate can be evaluated, and std::invalid_argument,
+	 * with nothing charged, if any candidate within the budget has the
+	 * wrong length.
+	 */
+	std::vector< double > values( const std::vector< std::vector< bool > >& batch );
+	std::vector< double > values( const std::vector< PackedBitvector >& batch );
+
 	///////////////////////////////
 
 	std::pair< long, double > getRemainingEvaluationsAtBestValue() const {
@@ -54,6 +86,7 @@ public:
 	
 	int getNumGenes() const { return instance.getNumGenes(); }	
 	long getRemainingEvaluations() const { return *remainingEvaluations; }
+	double getUpperBound() const { return instance.getUpperBound(); }
 	
 	///////////////////////////////	
 	
@@ -0,0 +1,181 @@
+#ifndef CBBOC_PACKEDBITVECTOR_HPP
+#define CBBOC_PACKEDBITVECTOR_HPP
+
+#include "cbboc/RNG.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+inline int popcount64( uint64_t x ) {
+#if defined( __GNUC__ ) || defined( __clang__ )
+	return __builtin_popcountll( x );
+#else
+	x = x - ( ( x >> 1 ) & 0x5555555555555555ULL );
+	x = ( x & 0x3333333333333333ULL ) + ( ( x >> 2 ) & 0x3333333333333333ULL );
+	x = ( x + ( x >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+	return static_cast< int >( ( x * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+// Index of the lowest set bit; x must be non-zero.
+inline int countTrailingZeros64( uint64_t x ) {
+#if defined( __GNUC__ ) || defined( __clang__ )
+	return __builtin_ctzll( x );
+#else
+	return popcount64( ( x & ( uint64_t( 0 ) - x ) ) - 1 );
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Fixed-length bitstring packed into 64-bit words.
+ *
+ * Bit i lives at bit ( i % 64 ) of word ( i / 64 ). Bits beyond size()
+ * in the last word are always zero, so that comparison, hashing,
+ * popcount and Hamming distance can work a word at a time.
+ */
+
+class PackedBitvector {
+
+	size_t numBits;
+	std::vector< uint64_t > words;
+
+	///////////////////////////////
+
+	static size_t wordsFor( size_t n ) { return ( n + 63 ) / 64; }
+
+	void clearTail() {
+		const size_t used = numBits % 64;
+		if( used != 0 )
+			words.back() &= ( uint64_t( 1 ) << used ) - 1;
+	}
+
+public:
+
+	PackedBitvector() : numBits( 0 ) {}
+
+	explicit PackedBitvector( size_t n, bool value = false )
+	: numBits( n ), words( wordsFor( n ), value ? ~uint64_t( 0 ) : 0 ) {
+		clearTail();
+	}
+
+	explicit PackedBitvector( const std::vector< bool >& v )
+	: numBits( v.size() ), words( wordsFor( v.size() ), 0 ) {
+		for( size_t i=0; i<numBits; ++i )
+			if( v[ i ] )
+				words[ i >> 6 ] |= uint64_t( 1 ) << ( i & 63 );
+	}
+
+	///////////////////////////////
+
+	size_t size() const { return numBits; }
+	size_t numWords() const { return words.size(); }
+	const uint64_t* data() const { return words.data(); }
+	uint64_t word( size_t w ) const { return words[ w ]; }
+
+	bool get( size_t i ) const { return ( words[ i >> 6 ] >> ( i & 63 ) ) & 1; }
+	bool operator []( size_t i ) const { return get( i ); }
+
+	void set( size_t i, bool value ) {
+		const uint64_t mask = uint64_t( 1 ) << ( i & 63 );
+		if( value )
+			words[ i >> 6 ] |= mask;
+		else
+			words[ i >> 6 ] &= ~mask;
+	}
+
+	void flip( size_t i ) { words[ i >> 6 ] ^= uint64_t( 1 ) << ( i & 63 ); }
+
+	///////////////////////////////
+
+	size_t popcount() const {
+		size_t result = 0;
+		for( size_t w=0; w<words.size(); ++w )
+			result += popcount64( words[ w ] );
+		return result;
+	}
+
+	size_t hammingDistance( const PackedBitvector& other ) const {
+		if( other.numBits != numBits )
+			throw std::invalid_argument( "Bad argument to PackedBitvector.hammingDistance" );
+
+		size_t result = 0;
+		for( size_t w=0; w<words.size(); ++w )
+			result += popcount64( words[ w ] ^ other.words[ w ] );
+		return result;
+	}
+
+	size_t hash() const {
+		// splitmix64 finaliser over each word, folded into the length.
+		uint64_t h = numBits;
+		for( size_t w=0; w<words.size(); ++w ) {
+			uint64_t z = h ^ ( words[ w ] + 0x9E3779B97F4A7C15ULL );
+			z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+			z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+			h = z ^ ( z >> 31 );
+		}
+		return static_cast< size_t >( h );
+	}
+
+	///////////////////////////////
+
+	// Fill with independent fair bits drawn from RNG::instance().
+	void randomize() {
+		std::uniform_int_distribution< uint64_t > dist;
+		for( size_t w=0; w<words.size(); ++w )
+			words[ w ] = dist( RNG::instance() );
+		clearTail();
+	}
+
+	std::vector< bool > toBitvector() const {
+		std::vector< bool > result( numBits );
+		for( size_t i=0; i<numBits; ++i )
+			result[ i ] = get( i );
+		return result;
+	}
+
+	///////////////////////////////
+
+	friend bool operator ==( const PackedBitvector& a, const PackedBitvector& b ) {
+		return a.numBits == b.numBits && a.words == b.words;
+	}
+
+	friend bool operator !=( const PackedBitvector& a, const PackedBitvector& b ) {
+		return !( a == b );
+	}
+
+	friend bool operator <( const PackedBitvector& a, const PackedBitvector& b ) {
+		return a.numBits != b.numBits ? a.numBits < b.numBits : a.words < b.words;
+	}
+
+	friend std::ostream& operator <<( std::ostream& s, const PackedBitvector& x ) {
+		for( size_t i=0; i<x.numBits; ++i )
+			s << ( x.get( i ) ? '1' : '0' );
+		return s;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+namespace std {
+
+template<>
+struct hash< PackedBitvector > {
+	size_t operator ()( const PackedBitvector& x ) const { return x.hash(); }
+};
+
+} // namespace std {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
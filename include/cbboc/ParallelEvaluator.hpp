@@ -0,0 +1,184 @@
+#ifndef CBBOC_PARALLELEVALUATOR_HPP
+#define CBBOC_PARALLELEVALUATOR_HPP
+
+#include "PackedBitvector.hpp"
+#include "ProblemInstance.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Evaluates single candidates of very large instances on a persistent
+ * pool of threads.
+ *
+ * The subfunctions are cut into parts of PART_SIZE consecutive
+ * subfunctions, which the calling thread and the pool take in turn, and
+ * the partial sums of the parts ( see ProblemInstance::partialValue )
+ * are added in part order. The parts depend only on M, so results are
+ * deterministic, bit for bit, whatever the number of threads or the
+ * scheduling, though they can differ from ProblemInstance::value in the
+ * last bits. Instances with fewer than MIN_PARALLEL_M subfunctions,
+ * for which waking the pool costs more than it saves, are evaluated
+ * by ProblemInstance::value on the calling thread, with no pool.
+ *
+ * One thread at a time may call value(). The instance must outlive the
+ * evaluator. Building with g++ on Linux needs -pthread.
+ */
+
+class ParallelEvaluator {
+public:
+
+	static const int PART_SIZE = 1 << 13;
+	static const int MIN_PARALLEL_M = 1 << 16;
+
+private:
+
+	const ProblemInstance& instance;
+	const int numParts;
+	std::vector< double > partials;
+	std::vector< std::thread > workers;
+
+	// The job in progress: the candidate ( one of the two ), the next
+	// part to take, and the number of parts not yet done.
+	const std::vector< bool >* bitvector;
+	const PackedBitvector* packed;
+	std::atomic< int > nextPart;
+	std::atomic< int > pendingParts;
+
+	// Guard the fields below, and are signalled when a job is posted or
+	// the pool is stopping, and when a job's last part is done or the
+	// last busy worker goes idle, respectively.
+	std::mutex mutex;
+	std::condition_variable posted;
+	std::condition_variable finished;
+	uint64_t generation;
+	int busyWorkers;
+	bool stopping;
+
+	///////////////////////////////
+
+	void evaluateParts() {
+		const int M = instance.getM();
+		for( int p = nextPart++; p < numParts; p = nextPart++ ) {
+			const int begin = p * PART_SIZE, end = std::min( M, begin + PART_SIZE );
+			partials[ p ] = bitvector ? instance.partialValue( *bitvector, begin, end )
+				: instance.partialValue( *packed, begin, end );
+
+			if( --pendingParts == 0 ) {
+				std::lock_guard< std::mutex > lock( mutex );
+				finished.notify_all();
+			}
+		}
+	}
+
+	void work() {
+		uint64_t seen = 0;
+		for( ;; ) {
+			{
+				std::unique_lock< std::mutex > lock( mutex );
+				posted.wait( lock, [ this, seen ] { return stopping || generation != seen; } );
+				if( stopping )
+					return;
+				seen = generation;
+				++busyWorkers;
+			}
+
+			evaluateParts();
+
+			std::lock_guard< std::mutex > lock( mutex );
+			if( --busyWorkers == 0 )
+				finished.notify_all();
+		}
+	}
+
+	double evaluate( const std::vector< bool >* bitvector_, const PackedBitvector* packed_ ) {
+		{
+			// A worker still draining the previous job would otherwise
+			// take parts of this one.
+			std::unique_lock< std::mutex > lock( mutex );
+			finished.wait( lock, [ this ] { return busyWorkers == 0; } );
+			bitvector = bitvector_;
+			packed = packed_;
+			nextPart = 0;
+			pendingParts = numParts;
+			++generation;
+		}
+		posted.notify_all();
+
+		evaluateParts();
+		{
+			std::unique_lock< std::mutex > lock( mutex );
+			finished.wait( lock, [ this ] { return pendingParts == 0; } );
+		}
+
+		double total = 0.0;
+		for( int p=0; p<numParts; ++p )
+			total += partials[ p ];
+		return total;
+	}
+
+	bool isPartitioned() const { return instance.getM() >= MIN_PARALLEL_M; }
+
+	///////////////////////////////
+
+public:
+
+	// numThreads, counting the calling thread, of 0 means one per
+	// hardware thread. No pool is started below MIN_PARALLEL_M.
+	explicit ParallelEvaluator( const ProblemInstance& instance_, unsigned numThreads = 0 )
+	: instance( instance_ ), numParts( ( instance_.getM() + PART_SIZE - 1 ) / PART_SIZE ),
+	  partials( numParts ), bitvector( nullptr ), packed( nullptr ), nextPart( 0 ), pendingParts( 0 ),
+	  generation( 0 ), busyWorkers( 0 ), stopping( false ) {
+		if( numThreads == 0 )
+			numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+		if( isPartitioned() )
+			for( unsigned t=1; t<std::min< unsigned >( numThreads, numParts ); ++t )
+				workers.push_back( std::thread( &ParallelEvaluator::work, this ) );
+	}
+
+	~ParallelEvaluator() {
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			stopping = true;
+		}
+		posted.notify_all();
+		for( size_t t=0; t<workers.size(); ++t )
+			workers[ t ].join();
+	}
+
+	ParallelEvaluator( const ParallelEvaluator& ) = delete;
+	ParallelEvaluator& operator =( const ParallelEvaluator& ) = delete;
+
+	///////////////////////////////
+
+	// Number of threads evaluating, including the calling thread.
+	unsigned getNumThreads() const { return static_cast< unsigned >( workers.size() ) + 1; }
+
+	double value( const std::vector< bool >& candidate ) {
+		if( !isPartitioned() || candidate.size() != instance.getNumGenes() )
+			return instance.value( candidate ); // ^ which rejects a bad size.
+
+		return evaluate( &candidate, nullptr );
+	}
+
+	double value( const PackedBitvector& candidate ) {
+		if( !isPartitioned() || candidate.size() != instance.getNumGenes() )
+			return instance.value( candidate );
+
+		return evaluate( nullptr, &candidate );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
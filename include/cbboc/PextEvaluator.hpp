@@ -0,0 +1,228 @@
+#ifndef CBBOC_PEXTEVALUATOR_HPP
+#define CBBOC_PEXTEVALUATOR_HPP
+
+#include "BatchKernels.hpp"
+#include "PackedBitvector.hpp"
+#include "VariableOrdering.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Evaluation backend that builds each table index with BMI2 PEXT.
+ *
+ * Variables are first renumbered into an internal order (by default,
+ * the order in which subfunctions first mention them), which tends to
+ * put each subfunction's variables into one or two 64-bit words. For
+ * every subfunction and every word it touches, a mask selects its
+ * variables in that word. One PEXT per mask then pulls all of those
+ * bits out at once, instead of K separate bit reads and shifts. Each
+ * table is re-indexed at construction to match the bit order PEXT
+ * produces. Subfunctions are still summed in order, so results are
+ * identical to the scalar path.
+ *
+ * Built from the flat arrays of a ProblemInstance, which owns it; see
+ * ProblemInstance::enablePextBackend().
+ */
+
+class PextEvaluator {
+
+	size_t numGenes;
+	int K;
+	int M;
+
+	// internal bit index of each (external) variable
+	std::vector< int > permutation;
+
+	// Subfunction i reads fields [ fieldOffsets[ i ], fieldOffsets[ i + 1 ] ):
+	// PEXT of word fieldWords[ f ] under fieldMasks[ f ], shifted left by fieldShifts[ f ].
+	std::vector< int > fieldOffsets;
+	std::vector< int > fieldWords;
+	std::vector< uint64_t > fieldMasks;
+	std::vector< int > fieldShifts;
+
+	// Re-indexed tables, still at a stride of 2^K entries.
+	std::vector< double > fnTables;
+
+	bool hardwarePext;
+
+	///////////////////////////////
+
+	static uint64_t softwarePext( uint64_t x, uint64_t mask ) {
+		uint64_t result = 0;
+		int bit = 0;
+		for( ; mask != 0; mask &= mask - 1, ++bit ) {
+			const uint64_t lowest = mask & ( uint64_t( 0 ) - mask );
+			if( x & lowest )
+				result |= uint64_t( 1 ) << bit;
+		}
+		return result;
+	}
+
+	double valueOfWordsSoftware( const uint64_t* words ) const {
+		const size_t tableSize = size_t( 1 ) << K;
+		const double* table = fnTables.data();
+		double total = 0.0;
+		for( int i=0; i<M; ++i, table += tableSize ) {
+			uint64_t fnTableIndex = 0;
+			for( int f=fieldOffsets[ i ]; f<fieldOffsets[ i + 1 ]; ++f )
+				fnTableIndex |= softwarePext( words[ fieldWords[ f ] ], fieldMasks[ f ] ) << fieldShifts[ f ];
+			total += table[ fnTableIndex ];
+		}
+		return total;
+	}
+
+#if CBBOC_HAVE_X86_KERNELS
+	__attribute__(( target( "bmi2" ) ))
+	double valueOfWordsBmi2( const uint64_t* words ) const {
+		const size_t tableSize = size_t( 1 ) << K;
+		const double* table = fnTables.data();
+		double total = 0.0;
+		for( int i=0; i<M; ++i, table += tableSize ) {
+			uint64_t fnTableIndex = 0;
+			for( int f=fieldOffsets[ i ]; f<fieldOffsets[ i + 1 ]; ++f )
+				fnTableIndex |= _pext_u64( words[ fieldWords[ f ] ], fieldMasks[ f ] ) << fieldShifts[ f ];
+			total += table[ fnTableIndex ];
+		}
+		return total;
+	}
+#endif
+
+	///////////////////////////////
+
+	void build( const std::vector< int >& varIndices, const std::vector< double >& tables ) {
+		const size_t tableSize = size_t( 1 ) << K;
+		fieldOffsets.assign( 1, 0 );
+		fnTables.assign( tables.size(), 0.0 );
+
+		std::vector< int > positions( K ), distinct;
+		std::vector< int > rank( K );
+		for( int i=0; i<M; ++i ) {
+			for( int j=0; j<K; ++j )
+				positions[ j ] = permutation[ varIndices[ i * K + j ] ];
+
+			// PEXT emits the selected bits in ascending internal position,
+			// word by word: that gives each distinct variable its bit in the
+			// new table index.
+			distinct = positions;
+			std::sort( distinct.begin(), distinct.end() );
+			distinct.erase( std::unique( distinct.begin(), distinct.end() ), distinct.end() );
+			for( int j=0; j<K; ++j )
+				rank[ j ] = static_cast< int >( std::lower_bound( distinct.begin(), distinct.end(), positions[ j ] ) - distinct.begin() );
+
+			for( size_t d=0; d<distinct.size(); ) {
+				const int word = distinct[ d ] >> 6;
+				uint64_t mask = 0;
+				const int shift = static_cast< int >( d );
+				for( ; d<distinct.size() && ( distinct[ d ] >> 6 ) == word; ++d )
+					mask |= uint64_t( 1 ) << ( distinct[ d ] & 63 );
+
+				fieldWords.push_back( word );
+				fieldMasks.push_back( mask );
+				fieldShifts.push_back( shift );
+			}
+			fieldOffsets.push_back( static_cast< int >( fieldWords.size() ) );
+
+			// Original index t has variable j at bit K-1-j; new index u has it at bit rank[ j ].
+			const size_t newTableSize = size_t( 1 ) << distinct.size();
+			for( size_t u=0; u<newTableSize; ++u ) {
+				size_t t = 0;
+				for( int j=0; j<K; ++j )
+					t |= ( ( u >> rank[ j ] ) & 1 ) << ( K - 1 - j );
+				fnTables[ i * tableSize + u ] = tables[ i * tableSize + t ];
+			}
+		}
+	}
+
+	///////////////////////////////
+
+public:
+
+	// Internal order in which variables are numbered by first use, scanning
+	// the subfunctions in order; unused variables go last.
+	static std::vector< int > firstUseOrder( size_t numGenes, const std::vector< int >& varIndices ) {
+		std::vector< int > result( numGenes, -1 );
+		int next = 0;
+		for( size_t e=0; e<varIndices.size(); ++e )
+			if( result[ varIndices[ e ] ] < 0 )
+				result[ varIndices[ e ] ] = next++;
+
+		for( size_t v=0; v<numGenes; ++v )
+			if( result[ v ] < 0 )
+				result[ v ] = next++;
+
+		return result;
+	}
+
+	///////////////////////////////
+
+	PextEvaluator( size_t numGenes_, int K_, int M_,
+		const std::vector< int >& varIndices, const std::vector< double >& tables,
+		const std::vector< int >& permutation_ )
+	: numGenes( numGenes_ ), K( K_ ), M( M_ ), permutation( permutation_ ),
+	  hardwarePext( cbboc_kernels::cpuHasBmi2() ) {
+		if( permutation.size() != numGenes || !isPermutation( permutation ) )
+			throw std::invalid_argument( "Bad permutation in PextEvaluator" );
+
+		build( varIndices, tables );
+
+		// An identity permutation needs no remapping of candidates.
+		bool identity = true;
+		for( size_t v=0; v<numGenes && identity; ++v )
+			identity = permutation[ v ] == static_cast< int >( v );
+		if( identity )
+			permutation.clear();
+	}
+
+	///////////////////////////////
+
+	bool usesHardwarePext() const { return hardwarePext; }
+
+	double value( const PackedBitvector& candidate ) const {
+		if( candidate.size() != numGenes )
+			throw std::invalid_argument( "Bad argument to PextEvaluator.value" );
+
+		if( permutation.empty() )
+			return valueOfInternalWords( candidate.data() );
+
+		// Scatter the candidate's set bits into internal order.
+		const size_t STACK_WORDS = 64;
+		uint64_t stackWords[ STACK_WORDS ];
+		std::vector< uint64_t > heapWords;
+		uint64_t* internal = stackWords;
+		if( candidate.numWords() > STACK_WORDS ) {
+			heapWords.resize( candidate.numWords() );
+			internal = heapWords.data();
+		}
+		std::fill( internal, internal + candidate.numWords(), 0 );
+
+		for( size_t w=0; w<candidate.numWords(); ++w ) {
+			for( uint64_t bits = candidate.word( w ); bits != 0; bits &= bits - 1 ) {
+				const int v = permutation[ w * 64 + countTrailingZeros64( bits ) ];
+				internal[ v >> 6 ] |= uint64_t( 1 ) << ( v & 63 );
+			}
+		}
+
+		return valueOfInternalWords( internal );
+	}
+
+private:
+
+	double valueOfInternalWords( const uint64_t* words ) const {
+#if CBBOC_HAVE_X86_KERNELS
+		if( hardwarePext )
+			return valueOfWordsBmi2( words );
+#endif
+		return valueOfWordsSoftware( words );
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
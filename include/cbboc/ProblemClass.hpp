@@ -5,31 +5,90 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "CBBOCUtil.hpp"
+#include "ClassArchive.hpp"
 #include "ObjectiveFn.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
-#include <vector>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////
 
+/**
+ * The training and testing instances of a problem class folder, listed
+ * in its inventories trainingFiles.txt and testingFiles.txt, or of a
+ * class archive ( see ClassArchive.hpp ), whose instances are mapped
+ * from it or read from it one at a time, as access says.
+ *
+ * Instances are loaded, and their ObjectiveFns built, concurrently on
+ * numThreads threads ( the calling thread among them ), each thread
+ * taking the next file in turn; the results keep inventory order. If
+ * any file fails to load, the error of the first such file in inventory
+ * order is thrown, naming its path. Building with g++ on Linux needs
+ * -pthread.
+ *
+ * With STREAM_TESTING, the testing instances are not loaded up front but
+ * through a TestingStream, one at a time, while the competitor is being
+ * tested on the ones before.
+ */
+
 class ProblemClass {
+public:
+
+	enum TestingLoad { LOAD_TESTING, STREAM_TESTING };
+
+private:
+
 	std::vector< ObjectiveFn > training, testing;
 	const TrainingCategory trainingCategory;
-public:
+	const TestingLoad testingLoad;
+	std::shared_ptr< const cbboc_archive::ClassArchive > archive; // ^ null for a class folder.
 
-	ProblemClass( const std::string& root, TrainingCategory _trainingCategory )
-	: trainingCategory( _trainingCategory ) {
+	// Where an instance comes from: the file at path, or entry of the
+	// archive, path then naming it.
+	struct Source {
+		std::string path;
+		size_t entry;
 
-		const std::string trainingFilesInventory = root + "/trainingFiles.txt";
-		const std::string testingFilesInventory = root + "/testingFiles.txt";
+		Source( const std::string& path_, size_t entry_ ) : path( path_ ), entry( entry_ ) {}
+	};
 
-		std::vector< std::string > trainingFiles = readInstances( trainingFilesInventory );
-		std::vector< std::string > testingFiles = readInstances( testingFilesInventory );
+	std::vector< Source > testingSources; // ^ with STREAM_TESTING only.
+
+public:
+
+	// root is a class folder or a class archive. numThreads of 0 means
+	// one per hardware thread.
+	ProblemClass( const std::string& root, TrainingCategory _trainingCategory, unsigned numThreads = 0,
+		TestingLoad _testingLoad = LOAD_TESTING,
+		cbboc_archive::ClassArchive::Access access = cbboc_archive::ClassArchive::MAP )
+	: trainingCategory( _trainingCategory ), testingLoad( _testingLoad ) {
+
+		std::vector< Source > trainingFiles, testingFiles;
+		if( cbboc_archive::isArchive( root ) ) {
+			archive = std::make_shared< const cbboc_archive::ClassArchive >( root, access );
+			for( size_t i=0; i<archive->size(); ++i )
+				( i < archive->numTraining() ? trainingFiles : testingFiles ).push_back(
+					Source( root + ":" + archive->name( i ), i ) );
+		}
+		else {
+			const std::vector< std::string > trainingNames = readInstances( root + "/trainingFiles.txt" );
+			const std::vector< std::string > testingNames = readInstances( root + "/testingFiles.txt" );
+			for( size_t i=0; i<trainingNames.size(); ++i )
+				trainingFiles.push_back( Source( root + "/" + trainingNames[ i ], 0 ) );
+			for( size_t i=0; i<testingNames.size(); ++i )
+				testingFiles.push_back( Source( root + "/" + testingNames[ i ], 0 ) );
+		}
 
 		///////////////////////////
 
@@ -40,48 +99,34 @@ public:
 			case LONG :	numTrainingEvaluationsMultiplier = 10; break;
 		}
 
-		std::vector< ProblemInstance > trainingInstances;
-		switch( trainingCategory ) {
-			case NONE :
-				// Intentionally Empty
-			break;
-			case SHORT :
-				for( size_t i=0; i<trainingFiles.size(); ++i ) {
-					std::ifstream ifs( root + "/" + trainingFiles[ i ] );
-					trainingInstances.push_back( ProblemInstance( ifs ) );
-				}
-			break;
-			case LONG :
-				for( size_t i=0; i<trainingFiles.size(); ++i ) {
-					std::ifstream ifs( root + "/" + trainingFiles[ i ] );
-					trainingInstances.push_back( ProblemInstance( ifs ) );
-				}
-			break;
-		}
+		// Training instances share one budget, only known once they are
+		// all loaded; ObjectiveFn doesn't read it before then.
+		std::shared_ptr< long > sharedTrainingEvaluations( new long( 0 ) );
 
-		long totalTrainingEvaluations = 0;
-		for( size_t i=0; i<trainingInstances.size(); ++i ) {
-			const ProblemInstance& p = trainingInstances[ i ];
-			totalTrainingEvaluations += p.getMaxEvalsPerInstance();
-		}
+		std::vector< Task > tasks;
+		if( trainingCategory != NONE )
+			for( size_t i=0; i<trainingFiles.size(); ++i )
+				tasks.push_back( Task( trainingFiles[ i ], ObjectiveFn::TimingMode::TRAINING, sharedTrainingEvaluations ) );
+		if( testingLoad == STREAM_TESTING )
+			testingSources = testingFiles;
+		else
+			for( size_t i=0; i<testingFiles.size(); ++i )
+				tasks.push_back( Task( testingFiles[ i ], ObjectiveFn::TimingMode::TESTING, nullptr ) );
 
-		std::shared_ptr< long > sharedTrainingEvaluations( new long( totalTrainingEvaluations * numTrainingEvaluationsMultiplier ) );
-		for( size_t i=0; i<trainingInstances.size(); ++i )
-			training.push_back( ObjectiveFn( trainingInstances[ i ], ObjectiveFn::TimingMode::TRAINING, sharedTrainingEvaluations ) );
+		runAll( tasks, archive.get(), numThreads );
 
 		///////////////////////////
 
-		std::vector< ProblemInstance > testingInstances;
-		for( size_t i=0; i<testingFiles.size(); ++i ) {
-			std::ifstream ifs( root + "/" + testingFiles[ i ] );
-			testingInstances.push_back( ProblemInstance( ifs ) );
-		}
-
-		for( size_t i=0; i<testingInstances.size(); ++i ) {
-			const ProblemInstance& p = testingInstances[ i ];
-			std::shared_ptr< long > individualTestingEvaluations( new long( p.getMaxEvalsPerInstance() ) );
-			testing.push_back( ObjectiveFn( p, ObjectiveFn::TimingMode::TESTING, individualTestingEvaluations ) );
+		long totalTrainingEvaluations = 0;
+		for( size_t i=0; i<tasks.size(); ++i ) {
+			if( tasks[ i ].timingMode == ObjectiveFn::TimingMode::TRAINING ) {
+				totalTrainingEvaluations += tasks[ i ].maxEvalsPerInstance;
+				training.push_back( std::move( *tasks[ i ].result ) );
+			}
+			else
+				testing.push_back( std::move( *tasks[ i ].result ) );
 		}
+		*sharedTrainingEvaluations = totalTrainingEvaluations * numTrainingEvaluationsMultiplier;
 	}
 
 	///////////////////////////////
@@ -92,10 +137,173 @@ public:
 	TrainingCategory getTrainingCategory() const { return trainingCategory; }
 	const std::vector< ObjectiveFn >& getTrainingInstances() const { return training; }
 	const std::vector< ObjectiveFn >& getTestingInstances() const { return testing; }
+
+	// Whether testing instances are to be read through openTestingStream(),
+	// getTestingInstances() then being empty.
+	bool isStreamingTesting() const { return testingLoad == STREAM_TESTING; }
+
+	bool isArchive() const { return archive != nullptr; }
 	
 	///////////////////////////////	
 	
 private:
+
+	struct Task {
+		Source source;
+		ObjectiveFn::TimingMode timingMode;
+		std::shared_ptr< long > remainingEvaluations; // ^ null for an individual budget.
+
+		std::unique_ptr< ObjectiveFn > result;
+		int maxEvalsPerInstance;
+		std::string error;
+
+		Task( const Source& source_, ObjectiveFn::TimingMode timingMode_, std::shared_ptr< long > remainingEvaluations_ )
+		: source( source_ ), timingMode( timingMode_ ), remainingEvaluations( remainingEvaluations_ ), maxEvalsPerInstance( 0 ) {}
+
+		void run( const cbboc_archive::ClassArchive* archive ) {
+			const std::string& path = source.path;
+			try {
+				const ProblemInstance instance = archive ? ProblemInstance( archive->instance( source.entry ) )
+					: loadInstance( path );
+				maxEvalsPerInstance = instance.getMaxEvalsPerInstance();
+				std::shared_ptr< long > evaluations = remainingEvaluations ? remainingEvaluations
+					: std::make_shared< long >( maxEvalsPerInstance );
+				result.reset( new ObjectiveFn( instance, timingMode, evaluations ) );
+			}
+			catch( std::exception& ex ) {
+				// Parse errors already name the file.
+				error = std::string( ex.what() ).find( path ) == std::string::npos ? path + ": " + ex.what() : ex.what();
+			}
+		}
+	};
+
+	static void runAll( std::vector< Task >& tasks, const cbboc_archive::ClassArchive* archive, unsigned numThreads ) {
+		if( numThreads == 0 )
+			numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+		std::atomic< size_t > next( 0 );
+		struct Worker {
+			static void run( std::vector< Task >* tasks, const cbboc_archive::ClassArchive* archive, std::atomic< size_t >* next ) {
+				for( size_t t = ( *next )++; t < tasks->size(); t = ( *next )++ )
+					( *tasks )[ t ].run( archive );
+			}
+		};
+
+		std::vector< std::thread > workers;
+		for( size_t t=1; t<std::min< size_t >( numThreads, tasks.size() ); ++t )
+			workers.push_back( std::thread( &Worker::run, &tasks, archive, &next ) );
+		Worker::run( &tasks, archive, &next );
+		for( size_t t=0; t<workers.size(); ++t )
+			workers[ t ].join();
+
+		for( size_t t=0; t<tasks.size(); ++t )
+			if( !tasks[ t ].result )
+				throw std::runtime_error( tasks[ t ].error );
+	}
+
+	///////////////////////////////
+
+public:
+
+	/**
+	 * The testing instances of a STREAM_TESTING class, loaded in inventory
+	 * order by a background thread into a queue of at most capacity
+	 * instances not yet taken. Each instance belongs to the caller once
+	 * taken, so its memory can be released as soon as it is done with.
+	 */
+	class TestingStream {
+
+		std::vector< Task > tasks;
+		std::shared_ptr< const cbboc_archive::ClassArchive > archive;
+		const size_t capacity;
+
+		// Tasks [ 0, loaded ) are done, those [ 0, taken ) handed out.
+		// Guarded by mutex; ready is signalled when a task is done, space
+		// when one is taken or the stream is closing.
+		size_t loaded;
+		size_t taken;
+		bool stopping;
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::condition_variable space;
+		std::thread loader;
+
+		void load() {
+			for( size_t t=0; t<tasks.size(); ++t ) {
+				{
+					std::unique_lock< std::mutex > lock( mutex );
+					space.wait( lock, [ this, t ] { return stopping || t - taken < capacity; } );
+					if( stopping )
+						return;
+				}
+
+				tasks[ t ].run( archive.get() );
+
+				std::lock_guard< std::mutex > lock( mutex );
+				loaded = t + 1;
+				ready.notify_one();
+			}
+		}
+
+	public:
+
+		TestingStream( const std::vector< Source >& sources, std::shared_ptr< const cbboc_archive::ClassArchive > archive_,
+			size_t capacity_ )
+		: archive( archive_ ), capacity( std::max< size_t >( capacity_, 1 ) ), loaded( 0 ), taken( 0 ), stopping( false ) {
+			for( size_t i=0; i<sources.size(); ++i )
+				tasks.push_back( Task( sources[ i ], ObjectiveFn::TimingMode::TESTING, nullptr ) );
+			loader = std::thread( &TestingStream::load, this );
+		}
+
+		~TestingStream() {
+			{
+				std::lock_guard< std::mutex > lock( mutex );
+				stopping = true;
+			}
+			space.notify_all();
+			loader.join();
+		}
+
+		TestingStream( const TestingStream& ) = delete;
+		TestingStream& operator =( const TestingStream& ) = delete;
+
+		size_t size() const { return tasks.size(); }
+
+		// The next testing instance, waiting for it to load, or null after
+		// the last. Throws, naming the file, if it could not be loaded.
+		std::unique_ptr< ObjectiveFn > next() {
+			std::unique_lock< std::mutex > lock( mutex );
+			ready.wait( lock, [ this ] { return taken < loaded || taken == tasks.size(); } );
+			if( taken == tasks.size() )
+				return nullptr;
+
+			Task& task = tasks[ taken++ ];
+			space.notify_one();
+			if( !task.result )
+				throw std::runtime_error( task.error );
+			return std::move( task.result );
+		}
+	};
+
+	static const size_t DEFAULT_STREAM_CAPACITY = 2;
+
+	// The stream of testing instances of a STREAM_TESTING class.
+	std::unique_ptr< TestingStream > openTestingStream( size_t capacity = DEFAULT_STREAM_CAPACITY ) const {
+		return std::unique_ptr< TestingStream >( new TestingStream( testingSources, archive, capacity ) );
+	}
+
+private:
+
+	///////////////////////////////
+
+	// The binary form of path ( see tools/ConvertInstances.cpp ), mapped,
+	// if it was converted from path as it is now; otherwise path itself.
+	static ProblemInstance loadInstance( const std::string& path ) {
+		const std::string binaryPath = cbboc_binary::binaryPathFor( path );
+		return ProblemInstance::load( cbboc_binary::isUpToDate( binaryPath, path ) ? binaryPath : path );
+	}
+
+	///////////////////////////////
 	
 	static std::vector< std::string >
 	readInstances( const std::string& testingFilesTxt ) {
@@ -1,21 +1,49 @@
 #ifndef CBBOC_PROBLEMINSTANCE_HPP
 #define CBBOC_PROBLEMINSTANCE_HPP
 
+#include "BatchKernels.hpp"
+#include "BinaryInstance.hpp"
 #include "CBBOCUtil.hpp"
+#include "CompiledInstances.hpp"
+#include "InstanceParser.hpp"
+#include "InternedTables.hpp"
+#include "MiniBucketBound.hpp"
+#include "PextEvaluator.hpp"
+#include "SharedArray.hpp"
+#include "ValueKernels.hpp"
+#include "VariableOrdering.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
 //////////////////////////////////////////////////////////////////////
 
 class ProblemInstance {
+public:
+
+	// COMPACT storage holds variable indices in 16 bits and table entries
+	// as 32-bit fixed point, at about half the footprint. Totals are then
+	// summed exactly and rounded once, so they can differ from those of
+	// STANDARD storage, which adds doubles in turn, in the last bits.
+	// Instances that don't fit ( more than 65536 variables, or values with
+	// more than InternedTables::MAX_DECIMALS decimals ) stay STANDARD.
+	enum Storage { STANDARD, COMPACT };
+
+private:
+
 	size_t numGenes;
 	int maxEvalsPerInstance;
 	int K;
-	std::vector< std::pair< std::vector< int >, std::vector< double > > > data;
 	
 	// Change for 2016:
 	// Instead of each file having N+1 rows (header and N functions), 
@@ -23,69 +51,259 @@ class ProblemInstance {
 	// with the value of M added to the end of the header.
 	int M;
 
+	// Compiled (immutable) layout, built once at load:
+	// the variable indices of subfunction i are varIndices[ i*K .. (i+1)*K ), 
+	// so that value() streams linearly through them, and its lookup table
+	// is interned, shared with any identical table and possibly coded 
+	// against a small value palette ( see InternedTables ).
+	// In compact storage the indices are held in compactVarIndices instead,
+	// and the tables in fixed point. Indices and tables are shared between
+	// copies, and may live in a mapped binary instance file.
+	SharedArray< int > varIndices;
+	std::vector< uint16_t > compactVarIndices;
+	InternedTables tables;
+	bool compact;
+
+	// Evaluation kernels, specialized on K where possible, chosen once at load.
+	cbboc_kernels::Kernels< std::vector< bool > >::Value bitvectorValue;
+	cbboc_kernels::Kernels< PackedBitvector >::Value packedValue;
+	cbboc_kernels::Kernels< std::vector< bool > >::Values bitvectorValues;
+	cbboc_kernels::Kernels< PackedBitvector >::Values packedValues;
+
+	// Optional PEXT backend for packed candidates, shared between copies.
+	std::shared_ptr< const PextEvaluator > pextBackend;
+
+	// Evaluator generated ahead of time for exactly this instance, if one
+	// is linked in ( see CompiledInstances.hpp ); used in STANDARD storage.
+	CompiledInstance compiled;
+
+	// No candidate scores above the upper bound: the sum of the table
+	// maxima, taken at load, tightened on first use by mini-bucket
+	// elimination ( see MiniBucketBound.hpp ) with this i-bound, except
+	// for very large or very dense instances. Shared between copies, so
+	// that this is done at most once per instance.
+	struct UpperBound {
+		std::once_flag once;
+		double value;
+		bool tightened;
+		UpperBound( double value_, bool tightened_ ) : value( value_ ), tightened( tightened_ ) {}
+	};
+	std::shared_ptr< UpperBound > upperBound;
+	static const int UPPER_BOUND_I_BOUND = 12;
+	static const size_t UPPER_BOUND_MAX_WIDTH = 40;
+	static const size_t UPPER_BOUND_MAX_NUM_GENES = 1 << 18;
+
 	///////////////////////////////
 
-	static bool allValidSize( const std::vector< std::pair< std::vector< int >, std::vector< double > > >& data, int k ) {
-
-		// const long expectedSize1 = k + 1;
-		// const long expectedSize2 = 1 << ( k + 1 );
-		const long expectedSize1 = k;
-		const long expectedSize2 = 1 << k;
-
-		for( size_t i=0; i<data.size(); ++i ) {
-			const std::pair< std::vector< int >, std::vector< double > >& p = data[ i ];
-			const long size1 = p.first.size();
-			const long size2 = p.second.size();
-			if( size1 != expectedSize1 || size2 != expectedSize2 ) {
-				CBBOC_INSPECT( size1 );
-				CBBOC_INSPECT( expectedSize1 );
-				CBBOC_INSPECT( size2 );
-				CBBOC_INSPECT( expectedSize2 );												
+	static bool allValidSize( size_t numVarIndices, const InternedTables& tables, int k, int m ) {
+
+		const size_t expectedSize1 = static_cast< size_t >( m ) * k;
+		const size_t expectedSize2 = static_cast< size_t >( m );
+
+		const size_t size1 = numVarIndices;
+		const size_t size2 = tables.getM();
+		if( size1 != expectedSize1 || size2 != expectedSize2 ) {
+			CBBOC_INSPECT( size1 );
+			CBBOC_INSPECT( expectedSize1 );
+			CBBOC_INSPECT( size2 );
+			CBBOC_INSPECT( expectedSize2 );
+			return false;
+		}
+		
+		return tables.invariant();
+	}
+
+	template < typename Candidate >
+	void checkBatch( const Candidate* batch, size_t count ) const {
+		for( size_t c=0; c<count; ++c )
+			if( batch[ c ].size() != getNumGenes() )
+				throw std::invalid_argument( "Bad argument to ProblemInstance.values" );
+	}
+
+	void selectKernels() {
+		using namespace cbboc_kernels;
+		const EntryStorage storage = tables.storage();
+		bitvectorValue = selectValueKernel< std::vector< bool > >( K, storage );
+		packedValue = selectValueKernel< PackedBitvector >( K, storage );
+		bitvectorValues = selectValuesKernel< std::vector< bool > >( K, storage );
+		packedValues = selectValuesKernel< PackedBitvector >( K, storage );
+	}
+
+	void compile( const std::vector< double >& fnTables, Storage storage ) {
+		tables = InternedTables( K, fnTables );
+
+		double maxima = 0.0;
+		const size_t tableSize = size_t( 1 ) << K;
+		for( int i=0; i<M; ++i ) {
+			double maximum = tables.entry( i, 0 );
+			for( size_t t=1; t<tableSize; ++t )
+				maximum = std::max( maximum, tables.entry( i, t ) );
+			maxima += maximum;
+		}
+		upperBound = std::make_shared< UpperBound >( maxima, false );
+
+		finishCompile( storage );
+	}
+
+	// Once tables and upperBound are set.
+	void finishCompile( Storage storage ) {
+		if( storage == COMPACT )
+			makeCompact();
+
+		selectKernels();
+		// ^ the fingerprint reads every entry, so is only taken if there is something to find.
+		const CompiledInstance* found = compact || compiledInstances().empty() ? nullptr : findCompiled();
+		compiled = found ? *found : CompiledInstance();
+		assert( invariant() );
+	}
+
+	// The registered evaluator generated from exactly this instance, or
+	// nullptr if there is none.
+	const CompiledInstance* findCompiled() const {
+		const uint64_t f = fingerprint();
+		const std::vector< CompiledInstance >& all = compiledInstances();
+		for( size_t i=0; i<all.size(); ++i )
+			if( all[ i ].fingerprint == f && isCompiledFrom( all[ i ] ) )
+				return &all[ i ];
+		return nullptr;
+	}
+
+	bool isCompiledFrom( const CompiledInstance& c ) const {
+		if( c.numGenes != numGenes || c.K != K || c.M != M )
+			return false;
+
+		const std::vector< int > vars = getVarIndices();
+		if( !vars.empty() && std::memcmp( c.vars, vars.data(), vars.size() * sizeof( int ) ) != 0 )
+			return false;
+
+		// Bitwise, as the generated pool reads back exactly.
+		const size_t tableSize = size_t( 1 ) << K;
+		for( int i=0; i<M; ++i ) {
+			if( c.tableOffsets[ i ] < 0 || c.tableOffsets[ i ] + tableSize > c.poolSize )
 				return false;
+			for( size_t t=0; t<tableSize; ++t ) {
+				const double entry = fnTableEntry( i, t );
+				if( std::memcmp( &c.pool[ c.tableOffsets[ i ] + t ], &entry, sizeof( entry ) ) != 0 )
+					return false;
 			}
 		}
-		
 		return true;
 	}
 
+	// Switch to compact storage if the indices fit in 16 bits and
+	// the tables in fixed point; otherwise leave things as they are.
+	void makeCompact() {
+		for( size_t e=0; e<varIndices.size(); ++e )
+			if( varIndices[ e ] < 0 || varIndices[ e ] > 0xFFFF )
+				return;
+
+		if( !tables.toFixedPoint() )
+			return;
+
+		compactVarIndices.assign( varIndices.begin(), varIndices.end() );
+		varIndices = SharedArray< int >();
+		compact = true;
+	}
+
+	void setVarIndices( const std::vector< int >& v ) {
+		if( compact )
+			compactVarIndices.assign( v.begin(), v.end() );
+		else
+			varIndices = SharedArray< int >( v );
+	}
+
+	cbboc_kernels::InstanceView view() const {
+		cbboc_kernels::InstanceView result;
+		result.M = M;
+		result.K = K;
+		result.vars = varIndices.data();
+		result.compactVars = compactVarIndices.data();
+		tables.fillView( result );
+		return result;
+	}
+
+	// The view of subfunctions [ begin, end ) only.
+	cbboc_kernels::InstanceView view( int begin, int end ) const {
+		cbboc_kernels::InstanceView result = view();
+		result.M = end - begin;
+		if( compact )
+			result.compactVars += static_cast< size_t >( begin ) * K;
+		else
+			result.vars += static_cast< size_t >( begin ) * K;
+		result.offsets += begin;
+		return result;
+	}
+
+	template < typename Candidate >
+	void checkRange( const Candidate& candidate, int begin, int end ) const {
+		if( candidate.size() != getNumGenes() || begin < 0 || begin > end || end > M )
+			throw std::invalid_argument( "Bad argument to ProblemInstance.partialValue" );
+	}
+
+	static cbboc_parser::InstanceData parse( std::basic_istream< char >& is ) {
+		std::vector< char > buffer;
+		cbboc_parser::readAll( is, buffer );
+		cbboc_parser::InstanceData result;
+		cbboc_parser::parseInstance( buffer.data(), buffer.data() + buffer.size(), "ProblemInstance", result );
+		return result;
+	}
+
+	// Takes the indices of data, which the parser has already checked.
+	ProblemInstance( cbboc_parser::InstanceData&& data, Storage storage )
+	: numGenes( data.numGenes ), maxEvalsPerInstance( data.maxEvalsPerInstance ), K( data.K ), M( data.M ),
+	  varIndices( std::move( data.varIndices ) ), compact( false ), compiled() {
+		compile( data.fnTables, storage );
+	}
+
 public:
+
+	// From a mapped binary instance ( see BinaryInstance.hpp ), evaluated
+	// in place in STANDARD storage, with the upper bound written there.
+	ProblemInstance( const cbboc_binary::MappedInstance& mapped, Storage storage = STANDARD )
+	: numGenes( mapped.header.numGenes ), maxEvalsPerInstance( mapped.header.maxEvalsPerInstance ),
+	  K( mapped.header.K ), M( mapped.header.M ), varIndices( mapped.vars ), compact( false ), compiled(),
+	  upperBound( std::make_shared< UpperBound >( mapped.header.upperBound, true ) ) {
+		tables = InternedTables( K, mapped.tableOffsets, mapped.palette, mapped.pool, mapped.codes );
+		finishCompile( storage );
+	}
 	
-	ProblemInstance( std::basic_istream< char >& is )
-	: numGenes( 0 ), maxEvalsPerInstance( 0 ), K( 0 ) {
-		
-		is >> numGenes;
-		is >> maxEvalsPerInstance;
-		is >> K;
-
-		// Previously the number of variables in each row was given by the third value in the header, 
-		// such that if that value was K, each row had K+1 variables. 
-		// I've changed this such that the third value now directly says how many variables are in each row.
-		is >> M;			
-		const int numRows = M;
-				
-		// for( size_t i=0; i<numGenes; ++i ) {
-		for( int i=0; i<numRows; ++i ) {			
-			int idummy;
-			std::vector< int > iarray;
-			// for( int j=0; j<K + 1; ++j ) {
-			for( int j=0; j<K; ++j ) {			
-				is >> idummy;
-				iarray.push_back( idummy );
-			}
+	// Reads the rest of is as an instance file ( see InstanceParser.hpp ).
+	ProblemInstance( std::basic_istream< char >& is, Storage storage = STANDARD )
+	: ProblemInstance( parse( is ), storage ) {}
 
-			double ddummy;
-			// const int numFks = 1 << ( K + 1 );
-			const int numFks = 1 << K;
-			std::vector< double > darray;
-			for( int j=0; j<numFks; ++j ) {
-				is >> ddummy;
-				darray.push_back( ddummy );
-			}
-				
-			data.push_back( std::make_pair( iarray, darray ) );
-		}
-		
-		assert( invariant() );
+	// From the flat layout of the file: K variable indices and 2^K table
+	// entries per subfunction, in subfunction order.
+	ProblemInstance( size_t numGenes_, int maxEvalsPerInstance_, int K_, 
+		const std::vector< int >& varIndices_, const std::vector< double >& fnTables, Storage storage = STANDARD )
+	: numGenes( numGenes_ ), maxEvalsPerInstance( maxEvalsPerInstance_ ), K( K_ ), M( 0 ), 
+	  varIndices( varIndices_ ), compact( false ), compiled() {
+		if( K <= 0 || K >= 31 || varIndices_.size() % K != 0 )
+			throw std::invalid_argument( "Bad argument to ProblemInstance" );
+
+		M = static_cast< int >( varIndices_.size() / K );
+		if( fnTables.size() != ( static_cast< size_t >( M ) << K ) )
+			throw std::invalid_argument( "Bad argument to ProblemInstance" );
+
+		for( size_t e=0; e<varIndices.size(); ++e )
+			if( varIndices[ e ] < 0 || static_cast< size_t >( varIndices[ e ] ) >= numGenes )
+				throw std::invalid_argument( "Bad argument to ProblemInstance" );
+
+		compile( fnTables, storage );
+	}
+
+	// Reads the instance file at path; errors give its line and column.
+	// A binary instance file ( see BinaryInstance.hpp ) is mapped instead,
+	// and in STANDARD storage evaluated in place.
+	static ProblemInstance load( const std::string& path, Storage storage = STANDARD ) {
+		if( cbboc_binary::isBinaryInstance( path ) )
+			return ProblemInstance( cbboc_binary::mapInstance( path ), storage );
+
+		std::vector< char > buffer;
+		cbboc_parser::readFile( path, buffer );
+		cbboc_parser::InstanceData data;
+		cbboc_parser::parseInstance( buffer.data(), buffer.data() + buffer.size(), path, data );
+		std::vector< char >().swap( buffer );
+		return ProblemInstance( std::move( data ), storage );
 	}
 
 	///////////////////////////////
@@ -93,30 +311,296 @@ public:
 	size_t getNumGenes() const { return numGenes;	}
 	int getMaxEvalsPerInstance() const { return maxEvalsPerInstance; }
 
+	int getK() const { return K; }
+	int getM() const { return M; }
+	
+	// A copy of all the variable indices, K per subfunction in subfunction order.
+	std::vector< int > getVarIndices() const {
+		return compact ? std::vector< int >( compactVarIndices.begin(), compactVarIndices.end() ) : varIndices.toVector();
+	}
+
+	bool isCompact() const { return compact; }
+	const InternedTables& getTables() const { return tables; }
+
+	// Entry index of subfunction i's lookup table.
+	double fnTableEntry( int i, size_t index ) const { return tables.entry( i, index ); }
+
+	// A copy of all the lookup tables, one after another in subfunction order.
+	std::vector< double > getFnTables() const { return tables.expand(); }
+
+	// No candidate has a higher value: at most the sum of the table
+	// maxima, and usually less ( see upperBound ). The first call may
+	// take a while on a large instance; it is safe from any thread.
+	double getUpperBound() const {
+		UpperBound& bound = *upperBound;
+		std::call_once( bound.once, [ this, &bound ]() {
+			if( !bound.tightened && numGenes < UPPER_BOUND_MAX_NUM_GENES )
+				bound.value = std::min( bound.value, cbboc_bounds::miniBucketBound( numGenes, K, getVarIndices(),
+					getFnTables(), UPPER_BOUND_I_BOUND, UPPER_BOUND_MAX_WIDTH, bound.value ) );
+		} );
+		return bound.value;
+	}
+
 	///////////////////////////////
 	
 	double value( const std::vector< bool >& candidate ) const {
 		if( candidate.size() != getNumGenes() )
 			throw std::invalid_argument( "Bad argument to ProblemInstance.value" ); // "candidate of length " + getNumGenes() + " expected, found " + candidate.length );
 		
-		double total = 0.0;
-		for( size_t i=0; i<M; ++i ) {
-
-			const std::vector< int >& varIndices = data[ i ].first;
-			int fnTableIndex = 0;
-			for( size_t j=0; j<varIndices.size(); ++j ) {
-				fnTableIndex <<= 1;
-				fnTableIndex |= candidate[ varIndices[ j ] ] ? 1 : 0;
+		if( usesCompiledEvaluator() )
+			return compiled.bitvectorValue( candidate );
+
+		return bitvectorValue( view(), candidate );
+	}
+
+	double value( const PackedBitvector& candidate ) const {
+		if( candidate.size() != getNumGenes() )
+			throw std::invalid_argument( "Bad argument to ProblemInstance.value" );
+		
+		if( usesCompiledEvaluator() )
+			return compiled.packedValue( candidate );
+
+		if( pextBackend )
+			return pextBackend->value( candidate );
+
+		return packedValue( view(), candidate );
+	}
+
+	// The sum of the entries of subfunctions [ begin, end ) only, added in
+	// subfunction order by the scalar kernel ( never the compiled evaluator 
+	// or PEXT backend ). Summing the partial values of consecutive ranges
+	// gives value() to within rounding.
+	double partialValue( const std::vector< bool >& candidate, int begin, int end ) const {
+		checkRange( candidate, begin, end );
+		return bitvectorValue( view( begin, end ), candidate );
+	}
+
+	double partialValue( const PackedBitvector& candidate, int begin, int end ) const {
+		checkRange( candidate, begin, end );
+		return packedValue( view( begin, end ), candidate );
+	}
+
+	bool usesCompiledEvaluator() const { return compiled.packedValue != nullptr; }
+
+	// 64-bit FNV-1a hash of the number of variables, K, M, the variable 
+	// indices and the bit patterns of the table entries: the key under 
+	// which compiled evaluators are registered.
+	uint64_t fingerprint() const {
+		uint64_t h = 14695981039346656037ULL;
+		struct Fnv {
+			static uint64_t add( uint64_t h, uint64_t x ) {
+				for( int b=0; b<8; ++b, x >>= 8 )
+					h = ( h ^ ( x & 0xFF ) ) * 1099511628211ULL;
+				return h;
 			}
-			
-			total += data[ i ].second[ fnTableIndex ];
+		};
+
+		h = Fnv::add( h, numGenes );
+		h = Fnv::add( h, static_cast< uint64_t >( K ) );
+		h = Fnv::add( h, static_cast< uint64_t >( M ) );
+		const std::vector< int > vars = getVarIndices();
+		for( size_t e=0; e<vars.size(); ++e )
+			h = Fnv::add( h, static_cast< uint64_t >( vars[ e ] ) );
+
+		const size_t tableSize = size_t( 1 ) << K;
+		for( int i=0; i<M; ++i )
+			for( size_t t=0; t<tableSize; ++t ) {
+				const double entry = fnTableEntry( i, t );
+				uint64_t bits;
+				std::memcpy( &bits, &entry, sizeof( bits ) );
+				h = Fnv::add( h, bits );
+			}
+
+		return h;
+	}
+
+	// Writes this instance as a binary instance file ( see BinaryInstance.hpp ),
+	// recording the size and modification time of the text file it came from.
+	// Only STANDARD storage can be written.
+	void writeBinary( std::ostream& os, uint64_t sourceSize = 0, int64_t sourceModified = 0 ) const {
+		if( compact )
+			throw std::invalid_argument( "Bad argument to ProblemInstance.writeBinary" );
+
+		const cbboc_kernels::InstanceView v = view();
+		const size_t numEntries = tables.numDistinctTables() << K;
+		cbboc_binary::Layout layout;
+		layout.numGenes = numGenes;
+		layout.maxEvalsPerInstance = maxEvalsPerInstance;
+		layout.K = K;
+		layout.M = M;
+		layout.vars = v.vars;
+		layout.tableOffsets = v.offsets;
+		layout.palette = v.palette;
+		layout.paletteSize = tables.getPalette().size();
+		layout.pool = tables.isCoded() ? nullptr : v.pool;
+		layout.codes = tables.isCoded() ? v.codes : nullptr;
+		layout.numEntries = tables.isCoded() ? numEntries + InternedTables::CODE_PADDING : numEntries;
+		layout.upperBound = getUpperBound();
+		cbboc_binary::writeInstance( layout, sourceSize, sourceModified, os );
+	}
+
+	///////////////////////////////	
+
+	// Route value() on packed candidates through the BMI2 PEXT backend,
+	// with variables renumbered internally by permutation (first-use 
+	// order if empty). Returns false, keeping the scalar path, if the
+	// CPU has no BMI2 or the instance is in COMPACT storage, whose exact
+	// fixed-point totals the backend, adding doubles, would not match.
+	bool enablePextBackend( const std::vector< int >& permutation = std::vector< int >() ) {
+		if( !permutation.empty() && ( permutation.size() != numGenes || !isPermutation( permutation ) ) )
+			throw std::invalid_argument( "Bad permutation in ProblemInstance.enablePextBackend" );
+
+		if( compact || !cbboc_kernels::cpuHasBmi2() )
+			return false;
+
+		const std::vector< int > vars = getVarIndices();
+		pextBackend = std::make_shared< const PextEvaluator >( numGenes, K, M, vars, getFnTables(),
+			permutation.empty() ? PextEvaluator::firstUseOrder( numGenes, vars ) : permutation );
+		return true;
+	}
+
+	void disablePextBackend() { pextBackend.reset(); }
+
+	bool usesPextBackend() const { return pextBackend != nullptr; }
+
+	///////////////////////////////	
+
+	// A copy of this instance in which variable v is renamed permutation[ v ].
+	// Subfunctions and tables are unchanged and summed in the same order, so
+	// values are exactly those of this instance on the renamed candidate. The
+	// PEXT backend, if any, is not carried over.
+	ProblemInstance renumbered( const std::vector< int >& permutation ) const {
+		if( permutation.size() != numGenes || !isPermutation( permutation ) )
+			throw std::invalid_argument( "Bad permutation in ProblemInstance.renumbered" );
+
+		const std::vector< int > vars = getVarIndices();
+		std::vector< int > newVars( vars.size() );
+		for( size_t e=0; e<vars.size(); ++e )
+			newVars[ e ] = permutation[ vars[ e ] ];
+
+		ProblemInstance result( *this );
+		result.pextBackend.reset();
+		result.compiled = CompiledInstance();
+		result.setVarIndices( newVars );
+
+		assert( result.invariant() );
+		return result;
+	}
+
+	// A copy of this instance in canonical form: each subfunction's variables
+	// are sorted, with its table permuted to match; subfunctions over the same
+	// set of variables are folded into the first of them, with the tables
+	// summed; and a subfunction whose variables all occur in one with more
+	// distinct variables ( possible only if it repeats a variable ) is folded
+	// into that. The subfunctions kept stay in their original order and the 
+	// PEXT backend, if any, is not carried over. Values agree with those of
+	// this instance to within rounding, and exactly in COMPACT storage.
+	ProblemInstance canonicalized() const {
+		const std::vector< int > vars = getVarIndices();
+		const size_t tableSize = size_t( 1 ) << K;
+
+		std::vector< int > sortedVars( vars );
+		std::vector< std::vector< int > > distinct( M );
+		std::vector< std::vector< int > > readers( numGenes );
+		for( int i=0; i<M; ++i ) {
+			const std::vector< int >::iterator row = sortedVars.begin() + i * K;
+			std::sort( row, row + K );
+			distinct[ i ].assign( row, row + K );
+			distinct[ i ].erase( std::unique( distinct[ i ].begin(), distinct[ i ].end() ), distinct[ i ].end() );
+			for( size_t v=0; v<distinct[ i ].size(); ++v )
+				readers[ distinct[ i ][ v ] ].push_back( i );
 		}
-		
-		return total;
+
+		// Each subfunction goes to the one with the most distinct variables 
+		// among those that read all of its variables, the first if tied.
+		std::vector< int > host( M );
+		for( int i=0; i<M; ++i ) {
+			host[ i ] = i;
+			const std::vector< int >& candidates = readers[ distinct[ i ].front() ];
+			for( size_t c=0; c<candidates.size(); ++c ) {
+				const int h = candidates[ c ];
+				const size_t size = distinct[ h ].size(), hostSize = distinct[ host[ i ] ].size();
+				if( ( size > hostSize || ( size == hostSize && h < host[ i ] ) ) &&
+					std::includes( distinct[ h ].begin(), distinct[ h ].end(), distinct[ i ].begin(), distinct[ i ].end() ) )
+					host[ i ] = h;
+			}
+		}
+
+		std::vector< int > newIndex( M, -1 );
+		std::vector< int > newVars;
+		for( int i=0; i<M; ++i ) {
+			if( host[ i ] == i ) {
+				newIndex[ i ] = static_cast< int >( newVars.size() / K );
+				newVars.insert( newVars.end(), sortedVars.begin() + i * K, sortedVars.begin() + ( i + 1 ) * K );
+			}
+		}
+
+		// Sum every table into its host's, in subfunction order. Entry u of
+		// a host sets its sorted variable p to bit K-1-p of u ( the first 
+		// occurrence winning for a repeated variable ), which gives the
+		// entry to add from each table. Fixed-point entries are summed exactly.
+		const double scale = tables.getScale();
+		std::vector< double > sums( newVars.size() / K * tableSize, 0.0 );
+		std::vector< char > assignment( numGenes, 0 );
+		for( int i=0; i<M; ++i ) {
+			const int h = host[ i ];
+			double* sum = sums.data() + newIndex[ h ] * tableSize;
+			for( size_t u=0; u<tableSize; ++u ) {
+				for( int p=K; p-- > 0; )
+					assignment[ sortedVars[ h * K + p ] ] = static_cast< char >( ( u >> ( K - 1 - p ) ) & 1 );
+
+				size_t t = 0;
+				for( int j=0; j<K; ++j )
+					t = ( t << 1 ) | assignment[ vars[ i * K + j ] ];
+
+				const double entry = fnTableEntry( i, t );
+				sum[ u ] += scale != 0.0 ? std::floor( entry * scale + 0.5 ) : entry;
+			}
+		}
+
+		if( scale != 0.0 )
+			for( size_t e=0; e<sums.size(); ++e )
+				sums[ e ] /= scale;
+
+		return ProblemInstance( numGenes, maxEvalsPerInstance, K, newVars, sums, compact ? COMPACT : STANDARD );
 	}
 	
 	///////////////////////////////	
 
+	// Evaluate count candidates back-to-back into result[ 0 .. count ).
+	// result[ c ] is always identical to value( batch[ c ] ).
+	void values( const std::vector< bool >* batch, size_t count, double* result ) const {
+		checkBatch( batch, count );
+		if( usesCompiledEvaluator() ) {
+			for( size_t c=0; c<count; ++c )
+				result[ c ] = compiled.bitvectorValue( batch[ c ] );
+			return;
+		}
+
+		bitvectorValues( view(), batch, count, result );
+	}
+
+	// Packed candidates go through the AVX2 gather kernel when the CPU
+	// supports it and storage is STANDARD, with the scalar path 
+	// evaluating whatever is left over.
+	void values( const PackedBitvector* batch, size_t count, double* result ) const {
+		checkBatch( batch, count );
+		if( usesCompiledEvaluator() ) {
+			for( size_t c=0; c<count; ++c )
+				result[ c ] = compiled.packedValue( batch[ c ] );
+			return;
+		}
+
+		size_t done = 0;
+#if CBBOC_HAVE_X86_KERNELS
+		if( !compact && cbboc_kernels::cpuHasAvx2() )
+			done = cbboc_kernels::valuesAvx2( view(), batch, count, result );
+#endif
+		packedValues( view(), batch + done, count - done, result + done );
+	}
+
+	///////////////////////////////	
+
 	friend std::ostream& operator <<( std::ostream& s, const ProblemInstance&  x ) {
 		s << "ProblemInstance[";		
 		s << "numGenes=" << x.numGenes;
@@ -124,12 +608,18 @@ public:
 		// s << ",K=" << x.K;
 		
 		s << ",data=[\n";		
-		for( size_t i=0; i<x.data.size(); ++i ) {
+		const size_t tableSize = size_t( 1 ) << x.K;
+		const std::vector< int > varIndices = x.getVarIndices();
+		for( int i=0; i<x.M; ++i ) {
 			
 			using namespace cbboc_std_io;
 
-			s << "(" << x.data[ i ].first;
-			s << "," << x.data[ i ].second;
+			const std::vector< int > vars( varIndices.begin() + i * x.K, varIndices.begin() + ( i + 1 ) * x.K );
+			std::vector< double > table( tableSize );
+			for( size_t t=0; t<tableSize; ++t )
+				table[ t ] = x.fnTableEntry( i, t );
+			s << "(" << vars;
+			s << "," << table;
 			s << ")\n";			
 		}
 		return s << "]]";	
@@ -142,8 +632,8 @@ public:
 			getMaxEvalsPerInstance() > 0 &&
 			K > 0 && 
 			// data.size() == getNumGenes() &&
-			data.size() == M &&
-			allValidSize( data, K );
+			allValidSize( compact ? compactVarIndices.size() : varIndices.size(), tables, K, M ) &&
+			compact == tables.isFixedPoint();
 	}
 
 	///////////////////////////////	
@@ -0,0 +1,57 @@
+#ifndef CBBOC_SHAREDARRAY_HPP
+#define CBBOC_SHAREDARRAY_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * An immutable array that either owns its elements, in a vector shared
+ * by all copies, or refers to memory kept alive by some other owner,
+ * such as a memory-mapped file ( see MappedFile ). Copies are cheap and
+ * never copy the elements; to change an array, assign a new one.
+ */
+
+template < typename T >
+class SharedArray {
+
+	const T* elements;
+	size_t count;
+	std::shared_ptr< const void > owner;
+
+public:
+
+	SharedArray() : elements( nullptr ), count( 0 ) {}
+
+	explicit SharedArray( std::vector< T > v ) : elements( nullptr ), count( v.size() ) {
+		std::shared_ptr< const std::vector< T > > shared = std::make_shared< const std::vector< T > >( std::move( v ) );
+		elements = shared->data();
+		owner = shared;
+	}
+
+	// The count elements at data, which owner keeps alive.
+	SharedArray( const T* data, size_t count_, std::shared_ptr< const void > owner_ )
+	: elements( data ), count( count_ ), owner( std::move( owner_ ) ) {}
+
+	///////////////////////////////
+
+	const T* data() const { return elements; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	const T& operator []( size_t i ) const { return elements[ i ]; }
+
+	const T* begin() const { return elements; }
+	const T* end() const { return elements + count; }
+
+	std::vector< T > toVector() const { return std::vector< T >( begin(), end() ); }
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,265 @@
+#ifndef CBBOC_VALUEKERNELS_HPP
+#define CBBOC_VALUEKERNELS_HPP
+
+#include "PackedBitvector.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Scalar evaluation kernels over the layout of ProblemInstance: M
+ * subfunctions of K variables, each with a table of 2^K entries that
+ * lives in an interned pool ( see InternedTables ), read through an
+ * InstanceView.
+ *
+ * Every kernel exists as a generic version, where K is a runtime value,
+ * and as versions specialized on K = 1 .. MAX_SPECIALIZED_K, where the
+ * table index construction is fully unrolled and the index stride is
+ * a compile-time constant; each comes in a version for every kind of
+ * EntryStorage. A ProblemInstance picks its kernels once, at load,
+ * with select*Kernel(). All versions add the subfunctions in the same
+ * order and so give identical results for the same storage.
+ */
+
+namespace cbboc_kernels {
+
+///////////////////////////////////
+
+const int MAX_SPECIALIZED_K = 8;
+
+// How table entries are stored ( see InternedTables ): as doubles, as 
+// codes into a palette of doubles, or the same two in fixed point. 
+// Fixed-point instances also keep their variable indices in 16 bits.
+enum EntryStorage { DOUBLE_POOL, CODED_POOL, FIXED_POOL, CODED_FIXED_POOL };
+
+// Everything a kernel reads. The variable indices of subfunction i are 
+// vars[ i*K .. (i+1)*K ) ( compactVars for fixed-point storage ), and its
+// table starts at entry offsets[ i ] of whichever pool is in use.
+struct InstanceView {
+	int M;
+	int K;
+	EntryStorage storage;
+	const int* vars;
+	const uint16_t* compactVars;
+	const int* offsets;
+	const double* pool;
+	const unsigned char* codes;
+	const double* palette;
+	const int32_t* fixedPool;
+	const int32_t* fixedPalette;
+	double scale;
+};
+
+// Fixed-point entries are summed exactly in 64 bits and scaled once at the end.
+template < int Storage >
+struct Entry;
+
+template <>
+struct Entry< DOUBLE_POOL > {
+	typedef int Index;
+	typedef double Sum;
+	static const Index* vars( const InstanceView& v ) { return v.vars; }
+	static double at( const InstanceView& v, size_t e ) { return v.pool[ e ]; }
+	static double total( const InstanceView&, Sum sum ) { return sum; }
+};
+
+template <>
+struct Entry< CODED_POOL > {
+	typedef int Index;
+	typedef double Sum;
+	static const Index* vars( const InstanceView& v ) { return v.vars; }
+	static double at( const InstanceView& v, size_t e ) { return v.palette[ v.codes[ e ] ]; }
+	static double total( const InstanceView&, Sum sum ) { return sum; }
+};
+
+template <>
+struct Entry< FIXED_POOL > {
+	typedef uint16_t Index;
+	typedef int64_t Sum;
+	static const Index* vars( const InstanceView& v ) { return v.compactVars; }
+	static int32_t at( const InstanceView& v, size_t e ) { return v.fixedPool[ e ]; }
+	static double total( const InstanceView& v, Sum sum ) { return static_cast< double >( sum ) / v.scale; }
+};
+
+template <>
+struct Entry< CODED_FIXED_POOL > {
+	typedef uint16_t Index;
+	typedef int64_t Sum;
+	static const Index* vars( const InstanceView& v ) { return v.compactVars; }
+	static int32_t at( const InstanceView& v, size_t e ) { return v.fixedPalette[ v.codes[ e ] ]; }
+	static double total( const InstanceView& v, Sum sum ) { return static_cast< double >( sum ) / v.scale; }
+};
+
+///////////////////////////////////
+
+inline int bitAt( const std::vector< bool >& candidate, int i ) { return candidate[ i ] ? 1 : 0; }
+
+inline int bitAt( const PackedBitvector& candidate, int i ) {
+	return static_cast< int >( ( candidate.data()[ i >> 6 ] >> ( i & 63 ) ) & 1 );
+}
+
+///////////////////////////////////
+
+template < int K, typename Candidate >
+struct TableIndex {
+	template < typename Index >
+	static int of( const Candidate& candidate, const Index* vars ) {
+		return ( TableIndex< K - 1, Candidate >::of( candidate, vars ) << 1 ) | bitAt( candidate, vars[ K - 1 ] );
+	}
+};
+
+template < typename Candidate >
+struct TableIndex< 0, Candidate > {
+	template < typename Index >
+	static int of( const Candidate&, const Index* ) { return 0; }
+};
+
+template < typename Candidate, typename Index >
+inline int tableIndex( const Candidate& candidate, const Index* vars, int K ) {
+	int fnTableIndex = 0;
+	for( int j=0; j<K; ++j ) {
+		fnTableIndex <<= 1;
+		fnTableIndex |= bitAt( candidate, vars[ j ] );
+	}
+	return fnTableIndex;
+}
+
+///////////////////////////////////
+
+template < typename Candidate >
+struct Kernels {
+	typedef double ( *Value )( const InstanceView& instance, const Candidate& candidate );
+	typedef void ( *Values )( const InstanceView& instance, const Candidate* batch, size_t count, double* result );
+};
+
+template < int K, typename Candidate, int Storage >
+double valueK( const InstanceView& instance, const Candidate& candidate ) {
+	typedef Entry< Storage > E;
+	const typename E::Index* vars = E::vars( instance );
+	typename E::Sum total = 0;
+	for( int i=0; i<instance.M; ++i, vars += K )
+		total += E::at( instance, instance.offsets[ i ] + TableIndex< K, Candidate >::of( candidate, vars ) );
+	return E::total( instance, total );
+}
+
+template < typename Candidate, int Storage >
+double valueGeneric( const InstanceView& instance, const Candidate& candidate ) {
+	typedef Entry< Storage > E;
+	const int K = instance.K;
+	const typename E::Index* vars = E::vars( instance );
+	typename E::Sum total = 0;
+	for( int i=0; i<instance.M; ++i, vars += K )
+		total += E::at( instance, instance.offsets[ i ] + tableIndex( candidate, vars, K ) );
+	return E::total( instance, total );
+}
+
+///////////////////////////////////
+
+// Batch kernels take candidates in blocks so that each subfunction's
+// indices and table are fetched once per block rather than once per
+// candidate. Every total is still summed in subfunction order.
+
+const size_t VALUES_BLOCK_SIZE = 8;
+
+template < int K, typename Candidate, int Storage >
+void valuesK( const InstanceView& instance, const Candidate* batch, size_t count, double* result ) {
+	typedef Entry< Storage > E;
+	for( size_t first=0; first<count; first += VALUES_BLOCK_SIZE ) {
+		const size_t blockSize = std::min( VALUES_BLOCK_SIZE, count - first );
+		const Candidate* block = batch + first;
+
+		typename E::Sum totals[ VALUES_BLOCK_SIZE ] = { 0 };
+		const typename E::Index* vars = E::vars( instance );
+		for( int i=0; i<instance.M; ++i, vars += K )
+			for( size_t c=0; c<blockSize; ++c )
+				totals[ c ] += E::at( instance, instance.offsets[ i ] + TableIndex< K, Candidate >::of( block[ c ], vars ) );
+
+		for( size_t c=0; c<blockSize; ++c )
+			result[ first + c ] = E::total( instance, totals[ c ] );
+	}
+}
+
+template < typename Candidate, int Storage >
+void valuesGeneric( const InstanceView& instance, const Candidate* batch, size_t count, double* result ) {
+	typedef Entry< Storage > E;
+	const int K = instance.K;
+	for( size_t first=0; first<count; first += VALUES_BLOCK_SIZE ) {
+		const size_t blockSize = std::min( VALUES_BLOCK_SIZE, count - first );
+		const Candidate* block = batch + first;
+
+		typename E::Sum totals[ VALUES_BLOCK_SIZE ] = { 0 };
+		const typename E::Index* vars = E::vars( instance );
+		for( int i=0; i<instance.M; ++i, vars += K )
+			for( size_t c=0; c<blockSize; ++c )
+				totals[ c ] += E::at( instance, instance.offsets[ i ] + tableIndex( block[ c ], vars, K ) );
+
+		for( size_t c=0; c<blockSize; ++c )
+			result[ first + c ] = E::total( instance, totals[ c ] );
+	}
+}
+
+///////////////////////////////////
+
+template < typename Candidate, int Storage >
+typename Kernels< Candidate >::Value selectValueKernel( int K ) {
+	switch( K ) {
+		case 1 : return &valueK< 1, Candidate, Storage >;
+		case 2 : return &valueK< 2, Candidate, Storage >;
+		case 3 : return &valueK< 3, Candidate, Storage >;
+		case 4 : return &valueK< 4, Candidate, Storage >;
+		case 5 : return &valueK< 5, Candidate, Storage >;
+		case 6 : return &valueK< 6, Candidate, Storage >;
+		case 7 : return &valueK< 7, Candidate, Storage >;
+		case 8 : return &valueK< 8, Candidate, Storage >;
+		default : return &valueGeneric< Candidate, Storage >;
+	}
+}
+
+template < typename Candidate, int Storage >
+typename Kernels< Candidate >::Values selectValuesKernel( int K ) {
+	switch( K ) {
+		case 1 : return &valuesK< 1, Candidate, Storage >;
+		case 2 : return &valuesK< 2, Candidate, Storage >;
+		case 3 : return &valuesK< 3, Candidate, Storage >;
+		case 4 : return &valuesK< 4, Candidate, Storage >;
+		case 5 : return &valuesK< 5, Candidate, Storage >;
+		case 6 : return &valuesK< 6, Candidate, Storage >;
+		case 7 : return &valuesK< 7, Candidate, Storage >;
+		case 8 : return &valuesK< 8, Candidate, Storage >;
+		default : return &valuesGeneric< Candidate, Storage >;
+	}
+}
+
+template < typename Candidate >
+typename Kernels< Candidate >::Value selectValueKernel( int K, EntryStorage storage ) {
+	switch( storage ) {
+		case CODED_POOL : return selectValueKernel< Candidate, CODED_POOL >( K );
+		case FIXED_POOL : return selectValueKernel< Candidate, FIXED_POOL >( K );
+		case CODED_FIXED_POOL : return selectValueKernel< Candidate, CODED_FIXED_POOL >( K );
+		default : return selectValueKernel< Candidate, DOUBLE_POOL >( K );
+	}
+}
+
+template < typename Candidate >
+typename Kernels< Candidate >::Values selectValuesKernel( int K, EntryStorage storage ) {
+	switch( storage ) {
+		case CODED_POOL : return selectValuesKernel< Candidate, CODED_POOL >( K );
+		case FIXED_POOL : return selectValuesKernel< Candidate, FIXED_POOL >( K );
+		case CODED_FIXED_POOL : return selectValuesKernel< Candidate, CODED_FIXED_POOL >( K );
+		default : return selectValuesKernel< Candidate, DOUBLE_POOL >( K );
+	}
+}
+
+///////////////////////////////////
+
+} // namespace cbboc_kernels {
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,124 @@
+#ifndef CBBOC_VARIABLEORDERING_HPP
+#define CBBOC_VARIABLEORDERING_HPP
+
+#include "PackedBitvector.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * Reverse Cuthill-McKee ordering of the variable interaction graph, in
+ * which two variables are adjacent if some subfunction reads both.
+ *
+ * Each connected component is traversed breadth-first from a vertex of
+ * minimum degree, visiting neighbours in order of increasing degree,
+ * and the resulting order is reversed. Variables that interact end up
+ * with nearby indices, which keeps the candidate bits read by
+ * consecutive subfunctions close together.
+ *
+ * Returns a permutation: result[ v ] is the new index of variable v.
+ */
+
+inline std::vector< int >
+reverseCuthillMcKee( size_t numGenes, int K, const std::vector< int >& varIndices ) {
+
+	const size_t M = K > 0 ? varIndices.size() / K : 0;
+
+	// Adjacency lists, without duplicates.
+	std::vector< std::vector< int > > adjacent( numGenes );
+	for( size_t i=0; i<M; ++i )
+		for( int a=0; a<K; ++a )
+			for( int b=0; b<K; ++b )
+				if( varIndices[ i * K + a ] != varIndices[ i * K + b ] )
+					adjacent[ varIndices[ i * K + a ] ].push_back( varIndices[ i * K + b ] );
+
+	std::vector< int > degree( numGenes );
+	for( size_t v=0; v<numGenes; ++v ) {
+		std::vector< int >& n = adjacent[ v ];
+		std::sort( n.begin(), n.end() );
+		n.erase( std::unique( n.begin(), n.end() ), n.end() );
+		degree[ v ] = static_cast< int >( n.size() );
+	}
+
+	struct ByDegree {
+		const std::vector< int >& degree;
+		explicit ByDegree( const std::vector< int >& d ) : degree( d ) {}
+		bool operator ()( int a, int b ) const {
+			return degree[ a ] != degree[ b ] ? degree[ a ] < degree[ b ] : a < b;
+		}
+	};
+
+	std::vector< int > byDegree( numGenes );
+	for( size_t v=0; v<numGenes; ++v )
+		byDegree[ v ] = static_cast< int >( v );
+	std::sort( byDegree.begin(), byDegree.end(), ByDegree( degree ) );
+
+	///////////////////////////////
+
+	std::vector< int > order;
+	order.reserve( numGenes );
+	std::vector< char > visited( numGenes, 0 );
+	std::vector< int > neighbours;
+	for( size_t s=0; s<numGenes; ++s ) {
+		const int start = byDegree[ s ];
+		if( visited[ start ] )
+			continue;
+
+		visited[ start ] = 1;
+		order.push_back( start );
+		for( size_t head=order.size() - 1; head<order.size(); ++head ) {
+			neighbours.clear();
+			const std::vector< int >& n = adjacent[ order[ head ] ];
+			for( size_t j=0; j<n.size(); ++j )
+				if( !visited[ n[ j ] ] ) {
+					visited[ n[ j ] ] = 1;
+					neighbours.push_back( n[ j ] );
+				}
+
+			std::sort( neighbours.begin(), neighbours.end(), ByDegree( degree ) );
+			order.insert( order.end(), neighbours.begin(), neighbours.end() );
+		}
+	}
+
+	std::vector< int > result( numGenes );
+	for( size_t k=0; k<numGenes; ++k )
+		result[ order[ k ] ] = static_cast< int >( numGenes - 1 - k );
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+inline bool isPermutation( const std::vector< int >& permutation ) {
+	std::vector< char > seen( permutation.size(), 0 );
+	for( size_t v=0; v<permutation.size(); ++v ) {
+		const int p = permutation[ v ];
+		if( p < 0 || static_cast< size_t >( p ) >= permutation.size() || seen[ p ] )
+			return false;
+		seen[ p ] = 1;
+	}
+	return true;
+}
+
+// out[ permutation[ v ] ] = in[ v ] for every variable v.
+inline void permuteBits( const std::vector< bool >& in, const std::vector< int >& permutation, std::vector< bool >& out ) {
+	out.resize( in.size() );
+	for( size_t v=0; v<in.size(); ++v )
+		out[ permutation[ v ] ] = in[ v ];
+}
+
+inline void permuteBits( const PackedBitvector& in, const std::vector< int >& permutation, PackedBitvector& out ) {
+	out = PackedBitvector( in.size() );
+	for( size_t w=0; w<in.numWords(); ++w )
+		for( uint64_t bits = in.word( w ); bits != 0; bits &= bits - 1 )
+			out.set( permutation[ w * 64 + countTrailingZeros64( bits ) ], true );
+}
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
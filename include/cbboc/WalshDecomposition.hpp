@@ -0,0 +1,261 @@
+#ifndef CBBOC_WALSHDECOMPOSITION_HPP
+#define CBBOC_WALSHDECOMPOSITION_HPP
+
+#include "PackedBitvector.hpp"
+#include "ProblemInstance.hpp"
+#include "ValueKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+/**
+ * A ProblemInstance as a sparse Walsh polynomial:
+ *
+ *     value( x ) = constant + sum over terms t of w_t * psi_t( x ),
+ *
+ * where psi_t( x ) is -1 if an odd number of the variables of term t
+ * are set in x, and +1 otherwise.
+ *
+ * Each subfunction's table, over its distinct variables, goes through a
+ * fast Walsh-Hadamard transform, giving at most 2^K coefficients; those
+ * of all subfunctions are then merged by variable set ( summed in
+ * subfunction order ), and coefficients within tolerance of 0 dropped.
+ * An index from each variable to the terms that contain it makes
+ * deltaIfFlipped() a sum over those terms only, and the mean over any
+ * hyperplane a single pass over the coefficients.
+ *
+ * Values agree with ProblemInstance::value to within rounding.
+ */
+
+class WalshDecomposition {
+
+	size_t numGenes;
+	double constant;
+
+	// Term t has coefficient coefficients[ t ] and variables
+	// vars[ varOffsets[ t ] .. varOffsets[ t + 1 ] ), sorted; terms are
+	// ordered by their variables, lexicographically.
+	std::vector< int > varOffsets;
+	std::vector< int > vars;
+	std::vector< double > coefficients;
+
+	// The terms containing variable v are terms[ termOffsets[ v ] .. termOffsets[ v + 1 ] ).
+	std::vector< int > termOffsets;
+	std::vector< int > terms;
+
+	///////////////////////////////
+
+	// In-place unnormalized Walsh-Hadamard transform of 2^d entries.
+	static void fastWalshHadamard( std::vector< double >& a ) {
+		for( size_t h=1; h<a.size(); h <<= 1 )
+			for( size_t i=0; i<a.size(); i += h << 1 )
+				for( size_t j=i; j<i + h; ++j ) {
+					const double x = a[ j ], y = a[ j + h ];
+					a[ j ] = x + y;
+					a[ j + h ] = x - y;
+				}
+	}
+
+	void decompose( const ProblemInstance& instance, double tolerance ) {
+		const int K = instance.getK();
+		const std::vector< int > varIndices = instance.getVarIndices();
+
+		std::map< std::vector< int >, double > merged;
+		constant = 0.0;
+		for( int i=0; i<instance.getM(); ++i ) {
+			std::vector< int > scope( varIndices.begin() + i * K, varIndices.begin() + ( i + 1 ) * K );
+			std::sort( scope.begin(), scope.end() );
+			scope.erase( std::unique( scope.begin(), scope.end() ), scope.end() );
+
+			// Entry u sets scope[ p ] to bit p of u.
+			const int d = static_cast< int >( scope.size() );
+			std::vector< double > table( size_t( 1 ) << d );
+			for( size_t u=0; u<table.size(); ++u ) {
+				size_t t = 0;
+				for( int j=0; j<K; ++j ) {
+					const size_t p = std::lower_bound( scope.begin(), scope.end(), varIndices[ i * K + j ] ) - scope.begin();
+					t = ( t << 1 ) | ( ( u >> p ) & 1 );
+				}
+				table[ u ] = instance.fnTableEntry( i, t );
+			}
+
+			fastWalshHadamard( table );
+			constant += table[ 0 ] / table.size();
+
+			std::vector< int > termVars;
+			for( size_t u=1; u<table.size(); ++u ) {
+				termVars.clear();
+				for( int p=0; p<d; ++p )
+					if( ( u >> p ) & 1 )
+						termVars.push_back( scope[ p ] );
+				merged[ termVars ] += table[ u ] / table.size();
+			}
+		}
+
+		varOffsets.assign( 1, 0 );
+		std::vector< int > degree( numGenes + 1, 0 );
+		for( std::map< std::vector< int >, double >::const_iterator it = merged.begin(); it != merged.end(); ++it ) {
+			if( std::fabs( it->second ) <= tolerance )
+				continue;
+
+			vars.insert( vars.end(), it->first.begin(), it->first.end() );
+			varOffsets.push_back( static_cast< int >( vars.size() ) );
+			coefficients.push_back( it->second );
+			for( size_t p=0; p<it->first.size(); ++p )
+				++degree[ it->first[ p ] + 1 ];
+		}
+
+		termOffsets.assign( numGenes + 1, 0 );
+		for( size_t v=0; v<numGenes; ++v )
+			termOffsets[ v + 1 ] = termOffsets[ v ] + degree[ v + 1 ];
+
+		terms.resize( termOffsets.back() );
+		std::vector< int > next( termOffsets.begin(), termOffsets.end() - 1 );
+		for( size_t t=0; t<coefficients.size(); ++t )
+			for( int e=varOffsets[ t ]; e<varOffsets[ t + 1 ]; ++e )
+				terms[ next[ vars[ e ] ]++ ] = static_cast< int >( t );
+	}
+
+	///////////////////////////////
+
+	template < typename Candidate >
+	double signOf( const Candidate& candidate, size_t t ) const {
+		int parity = 0;
+		for( int e=varOffsets[ t ]; e<varOffsets[ t + 1 ]; ++e )
+			parity ^= cbboc_kernels::bitAt( candidate, vars[ e ] );
+		return parity ? -1.0 : 1.0;
+	}
+
+	template < typename Candidate >
+	double valueOf( const Candidate& candidate ) const {
+		double total = constant;
+		for( size_t t=0; t<coefficients.size(); ++t )
+			total += coefficients[ t ] * signOf( candidate, t );
+		return total;
+	}
+
+	template < typename Candidate >
+	double deltaOf( const Candidate& candidate, size_t v ) const {
+		double sum = 0.0;
+		for( int e=termOffsets[ v ]; e<termOffsets[ v + 1 ]; ++e )
+			sum += coefficients[ terms[ e ] ] * signOf( candidate, terms[ e ] );
+		return -2.0 * sum;
+	}
+
+	template < typename Candidate >
+	void checkCandidate( const Candidate& candidate, const char* where ) const {
+		if( candidate.size() != numGenes )
+			throw std::invalid_argument( std::string( "Bad argument to WalshDecomposition." ) + where );
+	}
+
+	void checkVariable( size_t v, const char* where ) const {
+		if( v >= numGenes )
+			throw std::invalid_argument( std::string( "Bad variable index in WalshDecomposition." ) + where );
+	}
+
+	///////////////////////////////
+
+public:
+
+	// Coefficients whose magnitude is at most tolerance are dropped; the
+	// default only removes those that cancel up to rounding.
+	explicit WalshDecomposition( const ProblemInstance& instance, double tolerance = 1e-12 )
+	: numGenes( instance.getNumGenes() ), constant( 0.0 ) {
+		decompose( instance, tolerance );
+	}
+
+	///////////////////////////////
+
+	size_t getNumGenes() const { return numGenes; }
+	size_t getNumTerms() const { return coefficients.size(); }
+
+	// The coefficient of the empty set, which is also the mean value.
+	double getConstant() const { return constant; }
+
+	double getCoefficient( size_t t ) const { return coefficients[ t ]; }
+
+	// The variables of term t, in increasing order.
+	std::vector< int > getTermVariables( size_t t ) const {
+		return std::vector< int >( vars.begin() + varOffsets[ t ], vars.begin() + varOffsets[ t + 1 ] );
+	}
+
+	// The terms that contain variable v, in increasing order.
+	std::vector< int > getTermsOf( size_t v ) const {
+		checkVariable( v, "getTermsOf" );
+		return std::vector< int >( terms.begin() + termOffsets[ v ], terms.begin() + termOffsets[ v + 1 ] );
+	}
+
+	///////////////////////////////
+
+	double value( const std::vector< bool >& candidate ) const {
+		checkCandidate( candidate, "value" );
+		return valueOf( candidate );
+	}
+
+	double value( const PackedBitvector& candidate ) const {
+		checkCandidate( candidate, "value" );
+		return valueOf( candidate );
+	}
+
+	// Change in value that flipping variable v of candidate would cause:
+	// each term containing v changes sign.
+	double deltaIfFlipped( const std::vector< bool >& candidate, size_t v ) const {
+		checkCandidate( candidate, "deltaIfFlipped" );
+		checkVariable( v, "deltaIfFlipped" );
+		return deltaOf( candidate, v );
+	}
+
+	double deltaIfFlipped( const PackedBitvector& candidate, size_t v ) const {
+		checkCandidate( candidate, "deltaIfFlipped" );
+		checkVariable( v, "deltaIfFlipped" );
+		return deltaOf( candidate, v );
+	}
+
+	///////////////////////////////
+
+	// Mean value over the hyperplane on which variable fixed[ i ] is
+	// values[ i ] for each i: only terms within the fixed variables
+	// contribute.
+	double hyperplaneMean( const std::vector< int >& fixed, const std::vector< bool >& values ) const {
+		if( fixed.size() != values.size() )
+			throw std::invalid_argument( "Bad argument to WalshDecomposition.hyperplaneMean" );
+
+		std::vector< signed char > assignment( numGenes, -1 );
+		for( size_t i=0; i<fixed.size(); ++i ) {
+			checkVariable( fixed[ i ], "hyperplaneMean" );
+			assignment[ fixed[ i ] ] = values[ i ] ? 1 : 0;
+		}
+
+		double result = constant;
+		for( size_t t=0; t<coefficients.size(); ++t ) {
+			int parity = 0;
+			int e = varOffsets[ t ];
+			for( ; e<varOffsets[ t + 1 ] && assignment[ vars[ e ] ] >= 0; ++e )
+				parity ^= assignment[ vars[ e ] ];
+			if( e == varOffsets[ t + 1 ] )
+				result += parity ? -coefficients[ t ] : coefficients[ t ];
+		}
+		return result;
+	}
+
+	// Variance of the value over all candidates: the sum of the squared
+	// coefficients.
+	double variance() const {
+		double result = 0.0;
+		for( size_t t=0; t<coefficients.size(); ++t )
+			result += coefficients[ t ] * coefficients[ t ];
+		return result;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////
+
+#endif
+
+// End ///////////////////////////////////////////////////////////////
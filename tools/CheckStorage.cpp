@@ -0,0 +1,114 @@
+#include "cbboc/ProblemInstance.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: CheckStorage [-n <candidates>] <instance file>...
+//
+// Checks COMPACT storage against STANDARD storage on each instance, over
+// random candidates ( 1000 by default, the same for every run ): each
+// COMPACT value must equal, bit for bit, the exact sum of the table
+// entries in fixed point, rounded once, and differ from the STANDARD
+// value, which adds doubles in turn, by at most TOLERANCE. Writes one
+// line per instance: its path, then either the largest difference seen
+// or why it stays STANDARD; or, if a check fails, the first failure.
+
+namespace {
+
+const double TOLERANCE = 1e-9;
+
+// The largest | COMPACT - STANDARD | value over count random candidates,
+// or -1 if the instance cannot be held in COMPACT storage.
+double check( const std::string& path, int count ) {
+	const ProblemInstance standard = ProblemInstance::load( path );
+	const ProblemInstance compact = ProblemInstance::load( path, ProblemInstance::COMPACT );
+	if( !compact.isCompact() )
+		return -1.0;
+
+	const std::vector< int > vars = compact.getVarIndices();
+	const int K = compact.getK();
+	const double scale = compact.getTables().getScale();
+
+	std::mt19937_64 rng( 1 );
+	std::vector< bool > candidate( compact.getNumGenes() );
+	double result = 0.0;
+	for( int c=0; c<count; ++c ) {
+		for( size_t v=0; v<candidate.size(); ++v )
+			candidate[ v ] = ( rng() >> 63 ) != 0;
+
+		int64_t ticks = 0;
+		for( int i=0; i<compact.getM(); ++i ) {
+			size_t t = 0;
+			for( int j=0; j<K; ++j )
+				t = ( t << 1 ) | candidate[ vars[ i * K + j ] ];
+			ticks += std::llround( compact.fnTableEntry( i, t ) * scale );
+		}
+
+		const double exact = static_cast< double >( ticks ) / scale;
+		const double value = compact.value( candidate );
+		if( value != exact ) {
+			std::ostringstream os;
+			os << std::setprecision( 17 ) << "candidate " << c << ": COMPACT value " << value << ", exact sum " << exact;
+			throw std::runtime_error( os.str() );
+		}
+
+		const double difference = std::fabs( value - standard.value( candidate ) );
+		if( !( difference <= TOLERANCE ) ) {
+			std::ostringstream os;
+			os << "candidate " << c << ": COMPACT and STANDARD values differ by " << difference;
+			throw std::runtime_error( os.str() );
+		}
+		result = std::max( result, difference );
+	}
+	return result;
+}
+
+} // namespace {
+
+//////////////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+
+	int count = 1000;
+	int first = 1;
+	if( argc > 2 && std::string( argv[ 1 ] ) == "-n" ) {
+		count = std::atoi( argv[ 2 ] );
+		first = 3;
+	}
+
+	if( first >= argc || count < 1 ) {
+		std::cerr << "usage: " << argv[ 0 ] << " [-n <candidates>] <instance file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	for( int a=first; a<argc; ++a ) {
+		const std::string path = argv[ a ];
+		try {
+			const double difference = check( path, count );
+			if( difference < 0.0 )
+				std::cout << path << " stays STANDARD" << std::endl;
+			else
+				std::cout << path << " ok, largest difference " << difference << std::endl;
+		}
+		catch( std::exception& ex ) {
+			std::cout << path << " failed " << ex.what() << std::endl;
+			result = EXIT_FAILURE;
+		}
+	}
+
+	return result;
+}
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,43 @@
+#include "cbboc/InstanceCompiler.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: CompileInstance <instance file> <output .cpp file> [name]
+//
+// Writes a specialized evaluator for the instance, to be compiled and 
+// linked alongside the program that loads it ( see InstanceCompiler.hpp ).
+// name, which defaults to the instance path, labels the generated code.
+
+int main( int argc, char *argv[] ) {
+
+	if( argc < 3 || argc > 4 ) {
+		std::cerr << "usage: " << argv[ 0 ] << " <instance file> <output .cpp file> [name]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try {
+		const std::string path = argv[ 1 ];
+		const ProblemInstance instance = ProblemInstance::load( path );
+
+		std::ofstream ofs( argv[ 2 ] );
+		if( !ofs )
+			throw std::runtime_error( std::string( "cannot open " ) + argv[ 2 ] );
+
+		cbboc_compiler::writeCompiledInstance( instance, argc == 4 ? argv[ 3 ] : path, ofs );
+		if( !ofs )
+			throw std::runtime_error( std::string( "error writing " ) + argv[ 2 ] );
+	}
+	catch( std::exception& ex ) {
+		std::cerr << "caught std exception in main, what=" << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// End ///////////////////////////////////////////////////////////////
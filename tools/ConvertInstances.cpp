@@ -0,0 +1,130 @@
+#include "cbboc/ProblemInstance.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: ConvertInstances [--verify | --check-parser] <instance file or class folder>...
+//
+// Converts each text instance file, or every instance listed in the
+// inventories of each class folder, to a binary instance file next to
+// it: the same name with .bin for .txt ( see BinaryInstance.hpp ).
+// ProblemClass then maps the binary files instead of parsing the text,
+// for as long as the text files are unchanged. With --verify, checks
+// instead that each binary file exists, is up to date and matches its
+// checksum. With --check-parser, checks instead that the parser's fast
+// path reads each text file exactly as strtod does, entry for entry.
+
+namespace {
+
+std::vector< std::string > instancesOf( const std::string& arg ) {
+	std::vector< std::string > result;
+	const char* inventories[] = { "/trainingFiles.txt", "/testingFiles.txt" };
+	for( int i=0; i<2; ++i ) {
+		std::ifstream ifs( ( arg + inventories[ i ] ).c_str() );
+		if( !ifs )
+			continue;
+
+		std::vector< std::string > tokens( ( std::istream_iterator< std::string >( ifs ) ), std::istream_iterator< std::string >() );
+		for( size_t t=1; t<tokens.size(); ++t )
+			result.push_back( arg + "/" + tokens[ t ] );
+	}
+
+	if( result.empty() )
+		result.push_back( arg );
+	return result;
+}
+
+void convert( const std::string& path ) {
+	const ProblemInstance instance = ProblemInstance::load( path );
+	uint64_t size = 0;
+	int64_t modified = 0;
+	if( !cbboc_binary::fileInfo( path, size, modified ) )
+		throw std::runtime_error( "cannot stat " + path );
+
+	// Written aside and renamed into place, since other processes may
+	// have the old file mapped.
+	const std::string binaryPath = cbboc_binary::binaryPathFor( path );
+	const std::string temporaryPath = binaryPath + ".tmp";
+	{
+		std::ofstream ofs( temporaryPath.c_str(), std::ios::binary );
+		if( !ofs )
+			throw std::runtime_error( "cannot open " + temporaryPath );
+		instance.writeBinary( ofs, size, modified );
+	}
+	if( std::rename( temporaryPath.c_str(), binaryPath.c_str() ) != 0 )
+		throw std::runtime_error( "cannot rename " + temporaryPath + " to " + binaryPath );
+}
+
+void verify( const std::string& path ) {
+	const std::string binaryPath = cbboc_binary::binaryPathFor( path );
+	if( !cbboc_binary::isUpToDate( binaryPath, path ) )
+		throw std::runtime_error( binaryPath + " is missing or out of date" );
+	cbboc_binary::mapInstance( binaryPath, true );
+}
+
+void checkParser( const std::string& path ) {
+	std::vector< char > buffer;
+	cbboc_parser::readFile( path, buffer );
+	cbboc_parser::InstanceData fast, reference;
+	cbboc_parser::parseInstance( buffer.data(), buffer.data() + buffer.size(), path, fast );
+	cbboc_parser::parseInstance( buffer.data(), buffer.data() + buffer.size(), path, reference, true );
+
+	if( fast.varIndices != reference.varIndices || fast.fnTables.size() != reference.fnTables.size() )
+		throw std::runtime_error( path + ": fast and reference parses differ in shape" );
+
+	// Bitwise, so that -0.0 and 0.0 count as different.
+	for( size_t e=0; e<fast.fnTables.size(); ++e )
+		if( std::memcmp( &fast.fnTables[ e ], &reference.fnTables[ e ], sizeof( double ) ) != 0 ) {
+			std::ostringstream os;
+			os.precision( 17 );
+			os << path << ": table entry " << e << " parsed as " << fast.fnTables[ e ] << ", strtod gives " << reference.fnTables[ e ];
+			throw std::runtime_error( os.str() );
+		}
+}
+
+} // namespace {
+
+//////////////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+
+	const std::string mode = argc > 1 ? argv[ 1 ] : "";
+	const bool verifying = mode == "--verify", checkingParser = mode == "--check-parser";
+	const int first = verifying || checkingParser ? 2 : 1;
+	if( first >= argc ) {
+		std::cerr << "usage: " << argv[ 0 ] << " [--verify | --check-parser] <instance file or class folder>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	for( int a=first; a<argc; ++a ) {
+		const std::vector< std::string > paths = instancesOf( argv[ a ] );
+		for( size_t p=0; p<paths.size(); ++p ) {
+			try {
+				if( verifying )
+					verify( paths[ p ] );
+				else if( checkingParser )
+					checkParser( paths[ p ] );
+				else
+					convert( paths[ p ] );
+			}
+			catch( std::exception& ex ) {
+				std::cerr << "caught std exception in main, what=" << ex.what() << std::endl;
+				result = EXIT_FAILURE;
+			}
+		}
+	}
+
+	return result;
+}
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,165 @@
+#include "cbboc/InstanceGenerator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: GenerateClass <class folder> [--option value]...
+//
+// Writes a complete problem class folder, as under resources/: the
+// instances in training/ and testing/, their inventories
+// trainingFiles.txt and testingFiles.txt, and an empty results/ folder.
+// The class can then be selected in resources/classFolder.txt. Options,
+// with their defaults ( see InstanceGenerator.hpp ):
+//
+//   --n 1000             number of variables
+//   --m <n>              number of subfunctions
+//   --k 3                variables per subfunction
+//   --model random       random, adjacent or clustered
+//   --cluster-size 32    variables per cluster, for clustered
+//   --mixing 0.1         chance of a variable outside the cluster
+//   --values uniform     uniform, levels or trap
+//   --levels 4           number of distinct values, for levels
+//   --evals <100 n>      evaluation budget per instance
+//   --seed 1
+//   --training 200       number of training instances
+//   --testing 50         number of testing instances
+
+namespace {
+
+void makeFolder( const std::string& path ) {
+#ifdef _WIN32
+	_mkdir( path.c_str() );
+#else
+	mkdir( path.c_str(), 0777 );
+#endif
+	struct stat info;
+	if( stat( path.c_str(), &info ) != 0 || !( info.st_mode & S_IFDIR ) )
+		throw std::runtime_error( "cannot create folder " + path );
+}
+
+std::string instanceName( const std::string& set, int i ) {
+	char buffer[ 32 ];
+	std::snprintf( buffer, sizeof( buffer ), "%05d", i );
+	return set + "/" + buffer + ".txt";
+}
+
+// Writes the first count instances of stream, and their inventory.
+void writeSet( const std::string& root, const std::string& set, int count, cbboc_generator::Stream stream,
+	const cbboc_generator::GeneratorSettings& settings ) {
+	makeFolder( root + "/" + set );
+
+	std::ofstream inventory( ( root + "/" + set + "Files.txt" ).c_str() );
+	inventory << count << '\n';
+	for( int i=0; i<count; ++i ) {
+		const std::string name = instanceName( set, i );
+		std::ofstream ofs( ( root + "/" + name ).c_str() );
+		if( !ofs )
+			throw std::runtime_error( "cannot open " + root + "/" + name );
+
+		cbboc_generator::writeGeneratedInstance( settings, stream, i, ofs );
+		inventory << name << '\n';
+	}
+
+	if( !inventory )
+		throw std::runtime_error( "error writing " + root + "/" + set + "Files.txt" );
+}
+
+template < typename T >
+T parse( const std::map< std::string, std::string >& options, const std::string& key, T defaultValue ) {
+	const std::map< std::string, std::string >::const_iterator it = options.find( key );
+	if( it == options.end() )
+		return defaultValue;
+
+	std::istringstream is( it->second );
+	T result;
+	if( !( is >> result ) || !is.eof() )
+		throw std::invalid_argument( "bad value for --" + key + ": " + it->second );
+	return result;
+}
+
+} // namespace {
+
+//////////////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+
+	if( argc < 2 || argc % 2 != 0 ) {
+		std::cerr << "usage: " << argv[ 0 ] << " <class folder> [--option value]..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try {
+		using namespace cbboc_generator;
+
+		const std::string root = argv[ 1 ];
+		std::map< std::string, std::string > options;
+		for( int a=2; a<argc; a += 2 ) {
+			const std::string key = argv[ a ];
+			if( key.size() < 3 || key.compare( 0, 2, "--" ) != 0 )
+				throw std::invalid_argument( "bad option " + key );
+			options[ key.substr( 2 ) ] = argv[ a + 1 ];
+		}
+
+		GeneratorSettings settings;
+		settings.numGenes = parse< size_t >( options, "n", 1000 );
+		settings.M = parse< int >( options, "m", static_cast< int >( settings.numGenes ) );
+		settings.K = parse< int >( options, "k", 3 );
+		settings.clusterSize = parse< int >( options, "cluster-size", settings.clusterSize );
+		settings.mixing = parse< double >( options, "mixing", settings.mixing );
+		settings.numLevels = parse< int >( options, "levels", settings.numLevels );
+		settings.maxEvals = parse< long >( options, "evals", 100L * static_cast< long >( settings.numGenes ) );
+		settings.seed = parse< uint64_t >( options, "seed", 1 );
+
+		const std::string model = parse< std::string >( options, "model", "random" );
+		if( model == "random" )
+			settings.adjacency = RANDOM;
+		else if( model == "adjacent" )
+			settings.adjacency = ADJACENT;
+		else if( model == "clustered" )
+			settings.adjacency = CLUSTERED;
+		else
+			throw std::invalid_argument( "bad value for --model: " + model );
+
+		const std::string values = parse< std::string >( options, "values", "uniform" );
+		if( values == "uniform" )
+			settings.values = UNIFORM;
+		else if( values == "levels" )
+			settings.values = LEVELS;
+		else if( values == "trap" )
+			settings.values = TRAP;
+		else
+			throw std::invalid_argument( "bad value for --values: " + values );
+
+		const int numTraining = parse< int >( options, "training", 200 );
+		const int numTesting = parse< int >( options, "testing", 50 );
+		if( numTraining < 1 || numTesting < 1 )
+			throw std::invalid_argument( "need at least one training and one testing instance" );
+
+		settings.check();
+		makeFolder( root );
+		makeFolder( root + "/results" );
+		writeSet( root, "training", numTraining, TRAINING_STREAM, settings );
+		writeSet( root, "testing", numTesting, TESTING_STREAM, settings );
+	}
+	catch( std::exception& ex ) {
+		std::cerr << "caught std exception in main, what=" << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// End ///////////////////////////////////////////////////////////////
@@ -0,0 +1,112 @@
+#include "cbboc/ClassArchive.hpp"
+#include "cbboc/ProblemInstance.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: PackClass <class folder> [archive]
+//        PackClass --verify <archive>...
+//
+// Packs the instances listed in the inventories of a class folder into
+// a class archive ( see ClassArchive.hpp ), by default the folder name
+// with .cbboc appended. ProblemClass opens an archive directly, as it
+// would the folder, and it can be selected in resources/classFolder.txt
+// in the same way. With --verify, checks instead that every instance of
+// each archive matches its checksum.
+
+namespace {
+
+std::vector< std::string > inventory( const std::string& path ) {
+	std::ifstream ifs( path.c_str() );
+	std::vector< std::string > tokens( ( std::istream_iterator< std::string >( ifs ) ), std::istream_iterator< std::string >() );
+	if( tokens.empty() || tokens.size() != static_cast< size_t >( std::atoi( tokens.front().c_str() ) ) + 1 )
+		throw std::runtime_error( "bad inventory " + path );
+
+	tokens.erase( tokens.begin() );
+	return tokens;
+}
+
+void pack( const std::string& folder, const std::string& archivePath ) {
+	const std::vector< std::string > training = inventory( folder + "/trainingFiles.txt" );
+	const std::vector< std::string > testing = inventory( folder + "/testingFiles.txt" );
+
+	// Written aside and renamed into place, since other processes may
+	// have the old archive mapped.
+	const std::string temporaryPath = archivePath + ".tmp";
+	{
+		std::ofstream ofs( temporaryPath.c_str(), std::ios::binary );
+		if( !ofs )
+			throw std::runtime_error( "cannot open " + temporaryPath );
+
+		cbboc_archive::ArchiveWriter writer( ofs );
+		for( size_t i=0; i<training.size() + testing.size(); ++i ) {
+			const bool isTraining = i < training.size();
+			const std::string& name = isTraining ? training[ i ] : testing[ i - training.size() ];
+			std::ostringstream image;
+			ProblemInstance::load( folder + "/" + name ).writeBinary( image );
+			writer.add( name, image.str(), isTraining );
+		}
+		writer.finish();
+	}
+	if( std::rename( temporaryPath.c_str(), archivePath.c_str() ) != 0 )
+		throw std::runtime_error( "cannot rename " + temporaryPath + " to " + archivePath );
+
+	std::cout << archivePath << ": " << training.size() << " training and " << testing.size() << " testing instances" << std::endl;
+}
+
+void verify( const std::string& archivePath ) {
+	const cbboc_archive::ClassArchive archive( archivePath, cbboc_archive::ClassArchive::READ );
+	for( size_t i=0; i<archive.size(); ++i )
+		archive.instance( i, true );
+}
+
+} // namespace {
+
+//////////////////////////////////////////////////////////////////////
+
+int main( int argc, char *argv[] ) {
+
+	const bool verifying = argc > 1 && std::string( argv[ 1 ] ) == "--verify";
+	if( verifying ? argc < 3 : ( argc < 2 || argc > 3 ) ) {
+		std::cerr << "usage: " << argv[ 0 ] << " <class folder> [archive]" << std::endl;
+		std::cerr << "       " << argv[ 0 ] << " --verify <archive>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	try {
+		if( verifying ) {
+			for( int a=2; a<argc; ++a ) {
+				try {
+					verify( argv[ a ] );
+				}
+				catch( std::exception& ex ) {
+					std::cerr << "caught std exception in main, what=" << ex.what() << std::endl;
+					result = EXIT_FAILURE;
+				}
+			}
+		}
+		else {
+			std::string folder( argv[ 1 ] );
+			while( folder.size() > 1 && folder[ folder.size() - 1 ] == '/' )
+				folder.erase( folder.size() - 1 );
+			pack( folder, argc > 2 ? argv[ 2 ] : folder + ".cbboc" );
+		}
+	}
+	catch( std::exception& ex ) {
+		std::cerr << "caught std exception in main, what=" << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return result;
+}
+
+// End ///////////////////////////////////////////////////////////////
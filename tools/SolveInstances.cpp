@@ -0,0 +1,53 @@
+#include "cbboc/ExactSolver.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////
+
+// Usage: SolveInstances [-m <memory budget in MiB>] <instance file>...
+//
+// Writes one line per instance to standard output: its path, then 
+// either its optimum value and an optimal candidate as a bit string, 
+// or "unsolved" and the reason ( see ExactSolver.hpp ). Redirected to 
+// a file, this caches reference optima for a whole class.
+
+int main( int argc, char *argv[] ) {
+
+	size_t memoryBudget = ExactSolver::DEFAULT_MEMORY_BUDGET;
+	int first = 1;
+	if( argc > 2 && std::string( argv[ 1 ] ) == "-m" ) {
+		memoryBudget = size_t( std::strtoul( argv[ 2 ], nullptr, 10 ) ) << 20;
+		first = 3;
+	}
+
+	if( first >= argc ) {
+		std::cerr << "usage: " << argv[ 0 ] << " [-m <memory budget in MiB>] <instance file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+	for( int a=first; a<argc; ++a ) {
+		const std::string path = argv[ a ];
+		try {
+			const ProblemInstance instance = ProblemInstance::load( path );
+			const ExactSolver::Result solution = ExactSolver( instance, memoryBudget ).solve();
+
+			std::cout << path << ' ' << std::setprecision( 15 ) << solution.bestValue << ' ';
+			for( size_t v=0; v<solution.best.size(); ++v )
+				std::cout << ( solution.best[ v ] ? '1' : '0' );
+			std::cout << std::endl;
+		}
+		catch( std::exception& ex ) {
+			std::cout << path << " unsolved " << ex.what() << std::endl;
+			result = EXIT_FAILURE;
+		}
+	}
+
+	return result;
+}
+
+// End ///////////////////////////////////////////////////////////////